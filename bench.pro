@@ -0,0 +1,68 @@
+QT -= widgets
+QT += gui quick location positioning
+
+TARGET = bench
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+include(google_benchmark.pri)
+
+include(compression.pri)
+include(src/3rdparty/libexif/libexif.pri)
+
+INCLUDEPATH += \
+    src \
+    src/3rdparty
+
+SOURCES += \
+    src/bench/bench_exif.cpp \
+    src/bench/bench_gpx.cpp \
+    src/bench/bench_model.cpp \
+    src/bench/fixtures.cpp \
+    src/bench/main.cpp \
+    src/exif/file.cpp \
+    src/exif/jpeg.cpp \
+    src/exif/reader.cpp \
+    src/exif/utils.cpp \
+    src/gpx/decompressor.cpp \
+    src/gpx/fitreader.cpp \
+    src/gpx/geojsonreader.cpp \
+    src/gpx/gpxreader.cpp \
+    src/gpx/kmlreader.cpp \
+    src/gpx/loader.cpp \
+    src/gpx/matcher.cpp \
+    src/gpx/nmeareader.cpp \
+    src/gpx/parser.cpp \
+    src/gpx/pyramid.cpp \
+    src/gpx/statistic.cpp \
+    src/gpx/trackreader.cpp \
+    src/model.cpp \
+    src/thumbnailprovider.cpp
+
+HEADERS += \
+    src/bench/fixtures.h \
+    src/exif/file.h \
+    src/exif/jpeg.h \
+    src/exif/reader.h \
+    src/exif/utils.h \
+    src/gpx/decompressor.h \
+    src/gpx/fitreader.h \
+    src/gpx/geojsonreader.h \
+    src/gpx/gpxreader.h \
+    src/gpx/kmlreader.h \
+    src/gpx/loader.h \
+    src/gpx/matcher.h \
+    src/gpx/mercator.h \
+    src/gpx/nmeareader.h \
+    src/gpx/parser.h \
+    src/gpx/pyramid.h \
+    src/gpx/statistic.h \
+    src/gpx/track.h \
+    src/gpx/trackreader.h \
+    src/jpeg/photo.h \
+    src/model.h \
+    src/thumbnailprovider.h
+
+RESOURCES += \
+    rsc/test.qrc
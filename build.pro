@@ -1,2 +1,2 @@
 TEMPLATE = subdirs
-SUBDIRS = geotagger.pro test.pro
+SUBDIRS = geotagger.pro geotagger-cli.pro test.pro bench.pro
@@ -0,0 +1,23 @@
+# Codecs for the compressed tracks, each one is used if pkg-config finds it
+CONFIG += link_pkgconfig
+
+packagesExist(zlib) {
+    PKGCONFIG += zlib
+    DEFINES += HAVE_ZLIB
+} else {
+    message("No zlib found - *.gpx.gz files are not supported.")
+}
+
+packagesExist(libzstd) {
+    PKGCONFIG += libzstd
+    DEFINES += HAVE_ZSTD
+} else {
+    message("No zstd found - *.gpx.zst files are not supported.")
+}
+
+packagesExist(bzip2) {
+    PKGCONFIG += bzip2
+    DEFINES += HAVE_BZIP2
+} else {
+    message("No bzip2 found - *.gpx.bz2 files are not supported.")
+}
@@ -0,0 +1,65 @@
+QT -= widgets
+QT += gui positioning
+
+TARGET = geotagger-cli
+
+CONFIG += c++17 console
+# src/gpx and src/jpeg both have a loader.cpp
+CONFIG += object_parallel_to_source
+CONFIG -= app_bundle
+
+include(compression.pri)
+include(src/3rdparty/libexif/libexif.pri)
+
+SOURCES += \
+    src/cli/main.cpp \
+    src/exif/file.cpp \
+    src/exif/jpeg.cpp \
+    src/exif/reader.cpp \
+    src/exif/utils.cpp \
+    src/gpx/collection.cpp \
+    src/gpx/decompressor.cpp \
+    src/gpx/fitreader.cpp \
+    src/gpx/geojsonreader.cpp \
+    src/gpx/gpxreader.cpp \
+    src/gpx/kmlreader.cpp \
+    src/gpx/loader.cpp \
+    src/gpx/matcher.cpp \
+    src/gpx/nmeareader.cpp \
+    src/gpx/parser.cpp \
+    src/gpx/statistic.cpp \
+    src/gpx/trackreader.cpp \
+    src/jpeg/cache.cpp \
+    src/jpeg/journal.cpp \
+    src/jpeg/loader.cpp \
+    src/jpeg/saver.cpp
+
+HEADERS += \
+    src/exif/file.h \
+    src/exif/jpeg.h \
+    src/exif/reader.h \
+    src/exif/utils.h \
+    src/gpx/collection.h \
+    src/gpx/decompressor.h \
+    src/gpx/fitreader.h \
+    src/gpx/geojsonreader.h \
+    src/gpx/gpxreader.h \
+    src/gpx/kmlreader.h \
+    src/gpx/loader.h \
+    src/gpx/matcher.h \
+    src/gpx/nmeareader.h \
+    src/gpx/parser.h \
+    src/gpx/statistic.h \
+    src/gpx/track.h \
+    src/gpx/trackreader.h \
+    src/jpeg/cache.h \
+    src/jpeg/fileprocessor.h \
+    src/jpeg/journal.h \
+    src/jpeg/loader.h \
+    src/jpeg/photo.h \
+    src/jpeg/saver.h \
+    src/task.h
+
+INCLUDEPATH += \
+    src \
+    src/3rdparty
@@ -1,33 +1,88 @@
 QT       += core gui widgets quick location positioning quickwidgets
 
 CONFIG += c++17
+# src/gpx and src/jpeg both have a loader.cpp
+CONFIG += object_parallel_to_source
 
+include(compression.pri)
 include(src/3rdparty/libexif/libexif.pri)
 include(src/3rdparty/libjpeg/libjpeg.pri)
 
 SOURCES += \
     src/exif/file.cpp \
+    src/exif/jpeg.cpp \
+    src/exif/reader.cpp \
     src/exif/utils.cpp \
+    src/folderwatcher.cpp \
+    src/gpx/collection.cpp \
+    src/gpx/decompressor.cpp \
+    src/gpx/fitreader.cpp \
+    src/gpx/geojsonreader.cpp \
+    src/gpx/gpxreader.cpp \
+    src/gpx/kmlreader.cpp \
     src/gpx/loader.cpp \
+    src/gpx/matcher.cpp \
+    src/gpx/nmeareader.cpp \
+    src/gpx/parser.cpp \
+    src/gpx/pyramid.cpp \
     src/gpx/statistic.cpp \
+    src/gpx/trackreader.cpp \
+    src/jobpanel.cpp \
+    src/jobs.cpp \
+    src/jpeg/cache.cpp \
+    src/jpeg/journal.cpp \
+    src/jpeg/loader.cpp \
+    src/jpeg/saver.cpp \
     src/main.cpp \
     src/mainwindow.cpp \
+    src/markermodel.cpp \
     src/model.cpp \
     src/pixmaplabel.cpp \
     src/selectionwatcher.cpp \
+    src/session.cpp \
+    src/spatialindex.cpp \
+    src/thumbnailprovider.cpp \
     src/timeadjustwidget.cpp \
 
 HEADERS += \
     src/abstractsettings.h \
     src/exif/file.h \
+    src/exif/jpeg.h \
+    src/exif/reader.h \
     src/exif/utils.h \
+    src/folderwatcher.h \
+    src/gpx/collection.h \
+    src/gpx/decompressor.h \
+    src/gpx/fitreader.h \
+    src/gpx/geojsonreader.h \
+    src/gpx/gpxreader.h \
+    src/gpx/kmlreader.h \
     src/gpx/loader.h \
+    src/gpx/matcher.h \
+    src/gpx/mercator.h \
+    src/gpx/nmeareader.h \
+    src/gpx/parser.h \
+    src/gpx/pyramid.h \
     src/gpx/statistic.h \
     src/gpx/track.h \
+    src/gpx/trackreader.h \
+    src/jobpanel.h \
+    src/jobs.h \
+    src/jpeg/cache.h \
+    src/jpeg/fileprocessor.h \
+    src/jpeg/journal.h \
+    src/jpeg/loader.h \
+    src/jpeg/photo.h \
+    src/jpeg/saver.h \
     src/mainwindow.h \
+    src/markermodel.h \
     src/model.h \
     src/pixmaplabel.h \
     src/selectionwatcher.h \
+    src/session.h \
+    src/spatialindex.h \
+    src/task.h \
+    src/thumbnailprovider.h \
     src/timeadjustwidget.h \
 
 FORMS += \
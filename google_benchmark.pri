@@ -0,0 +1,23 @@
+isEmpty(BENCHMARK_DIR):BENCHMARK_DIR = $$(BENCHMARK_DIR)
+
+isEmpty(BENCHMARK_DIR) {
+    # fall back to the installed package
+    requires(packagesExist(benchmark))
+
+    !packagesExist(benchmark):message("No google benchmark found - install it or set BENCHMARK_DIR to its prefix to enable.")
+
+    CONFIG += link_pkgconfig
+    PKGCONFIG += benchmark
+} else {
+    requires(exists($$BENCHMARK_DIR/include/benchmark/benchmark.h))
+
+    !exists($$BENCHMARK_DIR/include/benchmark/benchmark.h):message("No google benchmark found in '$$BENCHMARK_DIR' - set BENCHMARK_DIR to its install prefix.")
+
+    INCLUDEPATH *= \
+        $$BENCHMARK_DIR/include
+
+    LIBS += -L$$BENCHMARK_DIR/lib -lbenchmark
+
+    unix: LIBS += -lpthread
+    win32: LIBS += -lshlwapi
+}
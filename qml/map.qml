@@ -10,6 +10,18 @@ Rectangle {
         plugin: Plugin { name: "osm"; }
         center:  QtPositioning.coordinate(59.91, 10.75) // Oslo
         zoomLevel: 5
+        onZoomLevelChanged: {
+            controller.setMapZoom(zoomLevel)
+            updateViewport()
+        }
+        onCenterChanged: updateViewport()
+        onWidthChanged: updateViewport()
+        onHeightChanged: updateViewport()
+        Component.onCompleted: controller.setMapZoom(zoomLevel)
+
+        function updateViewport() {
+            markers.setViewport(toCoordinate(Qt.point(0, 0), false), toCoordinate(Qt.point(width, height), false), zoomLevel)
+        }
 
         MapPolyline {
             id: track
@@ -27,12 +39,9 @@ Rectangle {
 
         Connections {
             target: controller
-            function onTrackChanged() {
-                var lines = []
-                for(var i = 0; i < controller.path.size(); i++){
-                    lines[i] = controller.path.coordinateAt(i)
-                }
-                track.path = lines;
+            function onPathChanged() {
+                // the whole QGeoPath goes to the polyline in one call, no per-point JS values
+                track.setPath(controller.path)
             }
             function onCenterChanged() {
                 centerAnimation.from = map.center
@@ -45,55 +54,84 @@ Rectangle {
         }
 
         MapItemView {
-            model: controller
+            // only the markers in the viewport, the close ones clustered
+            model: markers
             delegate: MapQuickItem {
                 coordinate: QtPositioning.coordinate(_latitude_, _longitude_)
-                anchorPoint: Qt.point(thumbnail.width * 0.5, thumbnail.height * 1.125)
-                sourceItem: Shape {
-                    id: thumbnail
+                anchorPoint: _count_ > 1 ? Qt.point(marker.width * 0.5, marker.height * 0.5)
+                                         : Qt.point(marker.width * 0.5, marker.height * 1.125)
+                sourceItem: Item {
+                    id: marker
                     width: 32
                     height: 32
-                    visible: true
 
-                    Image {
-                        id: pic
-                        source: _pixmap_
-                    }
+                    Rectangle {
+                        id: cluster
+                        anchors.fill: parent
+                        radius: width * 0.5
+                        color: "white"
+                        border.color: "black"
+                        visible: _count_ > 1
+
+                        Text {
+                            anchors.centerIn: parent
+                            text: _count_
+                        }
 
-                    Text {
-                        text: _name_
-                        color: selection.current === _index_ ? "blue" : "black"
-                        anchors.horizontalCenter: pic.horizontalCenter
-                        anchors.bottom: pic.top
-                        anchors.topMargin: 5
+                        MouseArea {
+                            anchors.fill: parent
+                            onClicked: {
+                                map.zoomLevel = Math.min(map.zoomLevel + 2, map.maximumZoomLevel)
+                                map.center = QtPositioning.coordinate(_latitude_, _longitude_)
+                            }
+                        }
                     }
 
-                    ShapePath {
-                        id: shape
-                        strokeColor: selection.current === _index_ ? "blue" : "black"
+                    Shape {
+                        id: thumbnail
+                        anchors.fill: parent
+                        visible: _count_ === 1
 
-                        property real half: thumbnail.width * 0.5
-                        property real quarter: thumbnail.width * 0.25
-                        property point center: Qt.point(thumbnail.x + thumbnail.width * 0.5 , thumbnail.y + thumbnail.height * 0.5)
+                        Image {
+                            id: pic
+                            source: _pixmap_
+                        }
 
-                        property point topLeft: Qt.point(center.x - half, center.y - half)
-                        property point topRight: Qt.point(center.x + half, center.y - half)
-                        property point bottomLeft: Qt.point(center.x - half, center.y + half)
-                        property point bottomRight: Qt.point(center.x + half, center.y + half)
-                        property point bottomCenter: Qt.point(center.x, center.y + half + quarter)
+                        Text {
+                            text: _name_
+                            color: selection.current === _index_ ? "blue" : "black"
+                            anchors.horizontalCenter: pic.horizontalCenter
+                            anchors.bottom: pic.top
+                            anchors.topMargin: 5
+                        }
 
-                        startX: shape.bottomLeft.x; startY: shape.bottomLeft.y
+                        ShapePath {
+                            id: shape
+                            strokeColor: selection.current === _index_ ? "blue" : "black"
 
-                        PathLine { x: shape.topLeft.x; y: shape.topLeft.y }
-                        PathLine { x: shape.topRight.x; y: shape.topRight.y }
-                        PathLine { x: shape.bottomRight.x; y: shape.bottomRight.y }
-                        PathLine { x: shape.bottomCenter.x; y: shape.bottomCenter.y }
-                        PathLine { x: shape.bottomLeft.x; y: shape.bottomLeft.y }
-                    }
+                            property real half: thumbnail.width * 0.5
+                            property real quarter: thumbnail.width * 0.25
+                            property point center: Qt.point(thumbnail.x + thumbnail.width * 0.5 , thumbnail.y + thumbnail.height * 0.5)
 
-                    MouseArea {
-                        anchors.fill: parent
-                        onClicked: { selection.current = _index_ }
+                            property point topLeft: Qt.point(center.x - half, center.y - half)
+                            property point topRight: Qt.point(center.x + half, center.y - half)
+                            property point bottomLeft: Qt.point(center.x - half, center.y + half)
+                            property point bottomRight: Qt.point(center.x + half, center.y + half)
+                            property point bottomCenter: Qt.point(center.x, center.y + half + quarter)
+
+                            startX: shape.bottomLeft.x; startY: shape.bottomLeft.y
+
+                            PathLine { x: shape.topLeft.x; y: shape.topLeft.y }
+                            PathLine { x: shape.topRight.x; y: shape.topRight.y }
+                            PathLine { x: shape.bottomRight.x; y: shape.bottomRight.y }
+                            PathLine { x: shape.bottomCenter.x; y: shape.bottomCenter.y }
+                            PathLine { x: shape.bottomLeft.x; y: shape.bottomLeft.y }
+                        }
+
+                        MouseArea {
+                            anchors.fill: parent
+                            onClicked: { selection.current = _index_ }
+                        }
                     }
                 }
             }
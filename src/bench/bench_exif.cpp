@@ -0,0 +1,186 @@
+#include <QFile>
+#include <QFileInfo>
+#include <QGeoCoordinate>
+
+#include <benchmark/benchmark.h>
+
+#include "exif/file.h"
+#include "exif/reader.h"
+#include "exif/utils.h"
+#include "fixtures.h"
+
+namespace
+{
+
+const int PhotoCount = 64;
+
+qint64 totalSize(const QStringList& paths)
+{
+    qint64 size = 0;
+    for (const QString& path: paths)
+        size += QFileInfo(path).size();
+    return size;
+}
+
+/// every sample photo as is and padded to several megabytes: loading must not depend on the file size
+void photoArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "kind", "size" });
+    for (auto kind: { Fixtures::Jpeg::WithGps, Fixtures::Jpeg::WithoutGps, Fixtures::Jpeg::WithoutExif })
+        for (qint64 size: { 0, 4 << 20, 16 << 20 })
+            benchmark->Args({ static_cast<int64_t>(kind), size });
+}
+
+/// the same tags as jpeg::Saver writes
+bool saveGps(const QString& path, double lat, double lon, QString* error)
+{
+    Exif::File exif;
+    if (!exif.load(path)) {
+        *error = exif.errorString();
+        return false;
+    }
+
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE, Exif::Utils::toDMS(lat));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE_REF, Exif::Utils::toLatitudeRef(lat));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE, Exif::Utils::toDMS(lon));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE_REF, Exif::Utils::toLongitudeRef(lon));
+
+    if (!exif.save(path)) {
+        *error = exif.errorString();
+        return false;
+    }
+
+    return true;
+}
+
+} // namespace
+
+static void BM_ExifLoad(benchmark::State& state)
+{
+    const auto kind = static_cast<Fixtures::Jpeg>(state.range(0));
+    const QStringList paths = Fixtures::photos(kind, state.range(1), PhotoCount);
+    if (paths.isEmpty())
+        return state.SkipWithError(qPrintable(Fixtures::lastError()));
+
+    for (auto _ : state)
+    {
+        for (const QString& path: paths)
+        {
+            Exif::File exif;
+            if (!exif.load(path))
+                return state.SkipWithError(qPrintable(exif.errorString()));
+            benchmark::DoNotOptimize(exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE));
+        }
+    }
+
+    Fixtures::setRates(state, "files/s", paths.size(), totalSize(paths));
+}
+BENCHMARK(BM_ExifLoad)->Apply(photoArgs)->Unit(benchmark::kMillisecond);
+
+/// what the import does: only the tags on the way to GPS and the shot time
+static void BM_ExifRead(benchmark::State& state)
+{
+    const auto kind = static_cast<Fixtures::Jpeg>(state.range(0));
+    const QStringList paths = Fixtures::photos(kind, state.range(1), PhotoCount);
+    if (paths.isEmpty())
+        return state.SkipWithError(qPrintable(Fixtures::lastError()));
+
+    for (auto _ : state)
+    {
+        for (const QString& path: paths)
+        {
+            Exif::Reader exif;
+            if (!exif.load(path))
+                return state.SkipWithError(qPrintable(exif.errorString()));
+            benchmark::DoNotOptimize(exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE));
+            benchmark::DoNotOptimize(exif.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZED));
+        }
+    }
+
+    Fixtures::setRates(state, "files/s", paths.size(), totalSize(paths));
+}
+BENCHMARK(BM_ExifRead)->Apply(photoArgs)->Unit(benchmark::kMillisecond);
+
+/// repeated saves of the same files: after the first one every save patches APP1 in place
+static void BM_ExifSaveInPlace(benchmark::State& state)
+{
+    const auto kind = static_cast<Fixtures::Jpeg>(state.range(0));
+    const QStringList paths = Fixtures::photos(kind, state.range(1), PhotoCount, true);
+    if (paths.isEmpty())
+        return state.SkipWithError(qPrintable(Fixtures::lastError()));
+
+    QString error;
+    for (const QString& path: paths)
+        if (!saveGps(path, 55.75, 37.61, &error))
+            return state.SkipWithError(qPrintable(error));
+
+    int i = 0;
+    for (auto _ : state)
+    {
+        for (const QString& path: paths)
+            if (!saveGps(path, 55.75 + 1e-5 * ++i, 37.61, &error))
+                return state.SkipWithError(qPrintable(error));
+    }
+
+    Fixtures::setRates(state, "files/s", paths.size(), totalSize(paths));
+}
+BENCHMARK(BM_ExifSaveInPlace)->Apply(photoArgs)->Unit(benchmark::kMillisecond);
+
+/// the first save of each file, which rebuilds it around a larger APP1 segment
+static void BM_ExifSaveRebuild(benchmark::State& state)
+{
+    const auto kind = static_cast<Fixtures::Jpeg>(state.range(0));
+    const QByteArray original = Fixtures::photo(kind, state.range(1));
+    const QStringList paths = Fixtures::photos(kind, state.range(1), PhotoCount, true);
+    if (paths.isEmpty())
+        return state.SkipWithError(qPrintable(Fixtures::lastError()));
+
+    QString error;
+    for (auto _ : state)
+    {
+        state.PauseTiming();
+        for (const QString& path: paths)
+        {
+            QFile file(path);
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(original) != original.size())
+                return state.SkipWithError(qPrintable(file.errorString()));
+        }
+        state.ResumeTiming();
+
+        for (const QString& path: paths)
+            if (!saveGps(path, 55.75, 37.61, &error))
+                return state.SkipWithError(qPrintable(error));
+    }
+
+    Fixtures::setRates(state, "files/s", paths.size(), paths.size() * original.size());
+}
+BENCHMARK(BM_ExifSaveRebuild)->Apply(photoArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_ToDMS(benchmark::State& state)
+{
+    double degrees = 0.;
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Exif::Utils::toDMS(degrees));
+        degrees += 0.0001;
+        if (degrees > 180.)
+            degrees = 0.;
+    }
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ToDMS);
+
+static void BM_FromLatLon(benchmark::State& state)
+{
+    const QVector<ExifRational> lat = Exif::Utils::toDMS(58.7203335774538746);
+    const QVector<ExifRational> lon = Exif::Utils::toDMS(37.6173);
+    const QByteArray latRef = "N";
+    const QByteArray lonRef = "E";
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Exif::Utils::fromLatLon(lat, latRef, lon, lonRef));
+
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FromLatLon);
@@ -0,0 +1,80 @@
+#include <QFileInfo>
+
+#include <benchmark/benchmark.h>
+
+#include "fixtures.h"
+#include "gpx/loader.h"
+#include "gpx/matcher.h"
+#include "gpx/pyramid.h"
+
+namespace
+{
+
+/// in one go and in parallel chunks, the small track is a single chunk either way
+void loadArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "points", "chunked" });
+    for (int points: { 10000, 1000000, 10000000 })
+        for (int chunked: { 0, 1 })
+            benchmark->Args({ points, chunked });
+}
+
+} // namespace
+
+static void BM_GpxLoad(benchmark::State& state)
+{
+    const int points = static_cast<int>(state.range(0));
+    const bool chunked = state.range(1) != 0;
+    const QString path = Fixtures::gpx(points);
+    if (path.isEmpty())
+        return state.SkipWithError(qPrintable(Fixtures::lastError()));
+
+    for (auto _ : state)
+    {
+        GPX::Loader loader;
+        if (!chunked)
+            loader.setChunkSize(0);
+        if (!loader.load(path))
+            return state.SkipWithError(qPrintable(loader.lastError()));
+        benchmark::DoNotOptimize(loader.track().size());
+    }
+
+    Fixtures::setRates(state, "points/s", points, QFileInfo(path).size());
+}
+BENCHMARK(BM_GpxLoad)->Apply(loadArgs)->Unit(benchmark::kMillisecond);
+
+static void BM_MatcherSetTrack(benchmark::State& state)
+{
+    const int points = static_cast<int>(state.range(0));
+
+    GPX::TrackStore track;
+    track.reserve(points);
+    for (int i = 0; i < points; ++i)
+        track.append(1625097600000 + i * 1000, 55.75, 37.60 + 1e-6 * i);
+
+    for (auto _ : state)
+    {
+        GPX::Matcher matcher;
+        matcher.setTrack(track);
+        benchmark::DoNotOptimize(matcher.isEmpty());
+    }
+
+    Fixtures::setRates(state, "points/s", points, 0);
+}
+BENCHMARK(BM_MatcherSetTrack)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond);
+
+static void BM_PyramidBuild(benchmark::State& state)
+{
+    const int points = static_cast<int>(state.range(0));
+
+    GPX::TrackStore track;
+    track.reserve(points);
+    for (int i = 0; i < points; ++i)
+        track.append(1625097600000 + i * 1000, 55.75 + 0.01 * (i % 1000) / 1000., 37.60 + 1e-6 * i);
+
+    for (auto _ : state)
+        benchmark::DoNotOptimize(GPX::Pyramid::build(track).size(GPX::Pyramid::MaxZoom));
+
+    Fixtures::setRates(state, "points/s", points, 0);
+}
+BENCHMARK(BM_PyramidBuild)->Arg(10000)->Arg(1000000)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include "fixtures.h"
+#include "model.h"
+
+namespace
+{
+
+const qint64 Start = 1625097600000; // 2021-07-01T00:00:00Z
+
+GPX::TrackStore track(int points)
+{
+    GPX::TrackStore track;
+    track.reserve(points);
+    for (int i = 0; i < points; ++i)
+        track.append(Start + i * 1000, 55.75 + 0.01 * (i % 1000) / 1000., 37.60 + 1e-6 * i);
+    return track;
+}
+
+/// \a count photos evenly spread over the track time, sorted by time as the loader usually adds them
+QList<jpeg::Photo> photos(int count, int points)
+{
+    QList<jpeg::Photo> photos;
+    for (int i = 0; i < count; ++i)
+    {
+        jpeg::Photo photo;
+        photo.path = photo.name = QString("IMG_%1.jpg").arg(i, 5, 10, QChar('0'));
+        photo.time = QDateTime::fromMSecsSinceEpoch(Start + qint64(points - 1) * 1000 * i / count, Qt::UTC);
+        photo.flags.haveShotTime = true;
+        photos.append(photo);
+    }
+    return photos;
+}
+
+void modelArgs(benchmark::internal::Benchmark* benchmark)
+{
+    benchmark->ArgNames({ "points", "photos" });
+    for (int points: { 10000, 1000000 })
+        for (int photos: { 100, 10000 })
+            benchmark->Args({ points, photos });
+}
+
+} // namespace
+
+static void BM_GuessPhotoCoordinates(benchmark::State& state)
+{
+    const int points = static_cast<int>(state.range(0));
+    const int count = static_cast<int>(state.range(1));
+
+    Model model;
+    model.setTrack(track(points));
+    model.add(photos(count, points));
+
+    for (auto _ : state)
+        model.guessPhotoCoordinates();
+
+    Fixtures::setRates(state, "files/s", count, 0);
+}
+BENCHMARK(BM_GuessPhotoCoordinates)->Apply(modelArgs)->Unit(benchmark::kMicrosecond);
+
+/// the time adjustment slider: photos move along their track intervals
+static void BM_SetTimeAdjust(benchmark::State& state)
+{
+    const int points = static_cast<int>(state.range(0));
+    const int count = static_cast<int>(state.range(1));
+
+    Model model;
+    model.setTrack(track(points));
+    model.add(photos(count, points));
+
+    qint64 adjust = 0;
+    for (auto _ : state)
+        model.setTimeAdjust(++adjust % 2 ? 1 : -1);
+
+    Fixtures::setRates(state, "files/s", count, 0);
+}
+BENCHMARK(BM_SetTimeAdjust)->Apply(modelArgs)->Unit(benchmark::kMicrosecond);
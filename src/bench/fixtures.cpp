@@ -0,0 +1,152 @@
+#include "fixtures.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <ctime>
+
+namespace
+{
+
+QString gLastError;
+
+QString fail(const QString& message, const QString& fileName)
+{
+    gLastError = message + " '" + fileName + "'";
+    return {};
+}
+
+QDir root()
+{
+    QDir temp(QStandardPaths::writableLocation(QStandardPaths::TempLocation));
+    temp.mkpath("geotagger-bench");
+    temp.cd("geotagger-bench");
+    return temp;
+}
+
+const char* resource(Fixtures::Jpeg kind)
+{
+    switch (kind) {
+    case Fixtures::Jpeg::WithGps:       return ":/img/with_gps.jpg";
+    case Fixtures::Jpeg::WithoutGps:    return ":/img/without_gps.jpg";
+    case Fixtures::Jpeg::WithoutExif:   return ":/img/without_exif.jpg";
+    }
+    return "";
+}
+
+} // namespace
+
+QString Fixtures::gpx(int points)
+{
+    const QString path = root().absoluteFilePath(QString("track-%1.gpx").arg(points));
+    if (QFileInfo::exists(path))
+        return path;
+
+    // QSaveFile leaves no half-written fixture behind if the generation is interrupted
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail("Unable to create", path);
+
+    file.write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+               "<gpx version=\"1.1\" creator=\"geotagger bench\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+               "<trk>\n"
+               "<name>bench</name>\n");
+
+    const int SegmentSize = 3600;
+    const time_t start = 1625097600; // 2021-07-01T00:00:00Z
+
+    char line[256];
+    for (int i = 0; i < points; ++i)
+    {
+        if (i % SegmentSize == 0)
+            file.write(i ? "</trkseg>\n<trkseg>\n" : "<trkseg>\n");
+
+        const time_t t = start + i;
+        const tm* utc = std::gmtime(&t);
+        const double lat = 55.75 + 0.01 * (i % 1000) / 1000.;
+        const double lon = 37.60 + 1e-6 * i;
+        const double ele = 150. + (i % 50);
+
+        const int size = std::snprintf(line, sizeof(line),
+                                       "<trkpt lat=\"%.7f\" lon=\"%.7f\"><ele>%.1f</ele>"
+                                       "<time>%04d-%02d-%02dT%02d:%02d:%02dZ</time></trkpt>\n",
+                                       lat, lon, ele,
+                                       utc->tm_year + 1900, utc->tm_mon + 1, utc->tm_mday,
+                                       utc->tm_hour, utc->tm_min, utc->tm_sec);
+        file.write(line, size);
+    }
+
+    file.write(points ? "</trkseg>\n</trk>\n</gpx>\n" : "</trk>\n</gpx>\n");
+
+    if (!file.commit())
+        return fail("Unable to write", path);
+
+    return path;
+}
+
+QByteArray Fixtures::photo(Jpeg kind, qint64 size)
+{
+    QFile original(resource(kind));
+    if (!original.open(QIODevice::ReadOnly)) {
+        fail("Unable to open", original.fileName());
+        return {};
+    }
+
+    // readers stop at the end of image marker, so the padding only adds to the file size
+    QByteArray data = original.readAll();
+    if (data.size() < size)
+        data.append(QByteArray(size - data.size(), '\0'));
+
+    return data;
+}
+
+QStringList Fixtures::photos(Jpeg kind, qint64 size, int count, bool writable)
+{
+    const QByteArray data = photo(kind, size);
+    if (data.isEmpty())
+        return {};
+
+    const QString name = QFileInfo(resource(kind)).baseName();
+    QDir dir = root();
+    const QString subdir = QString("%1-%2%3").arg(name).arg(data.size()).arg(writable ? "-rw" : "");
+    if (!dir.mkpath(subdir) || !dir.cd(subdir)) {
+        fail("Unable to create", dir.absoluteFilePath(subdir));
+        return {};
+    }
+
+    QStringList paths;
+    for (int i = 0; i < count; ++i)
+    {
+        const QString path = dir.absoluteFilePath(QString("IMG_%1.jpg").arg(i, 5, 10, QChar('0')));
+        paths.append(path);
+
+        QFile file(path);
+        if (!writable && file.size() == data.size())
+            continue;
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || file.write(data) != data.size()) {
+            fail("Unable to write", path);
+            return {};
+        }
+    }
+
+    return paths;
+}
+
+QString Fixtures::lastError()
+{
+    return gLastError;
+}
+
+void Fixtures::setRates(benchmark::State& state, const char* counter, qint64 items, qint64 bytes)
+{
+    state.counters[counter] = benchmark::Counter(items, benchmark::Counter::kIsIterationInvariantRate);
+    if (bytes)
+        state.SetBytesProcessed(state.iterations() * bytes);
+}
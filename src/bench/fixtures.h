@@ -0,0 +1,34 @@
+#ifndef BENCH_FIXTURES_H
+#define BENCH_FIXTURES_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+namespace benchmark { class State; }
+
+/// Generated input for the benchmarks. Fixtures are written once into
+/// <temp>/geotagger-bench and reused by later runs, so only the first run pays for them.
+namespace Fixtures
+{
+
+enum class Jpeg { WithGps, WithoutGps, WithoutExif };
+
+/// synthetic track of \a points one second apart, split into hour-long segments
+QString gpx(int points);
+
+/// \a count copies of a sample photo, padded to \a size bytes after the end of image;
+/// \a writable copies are kept apart and rewritten on every call since the benchmarks modify them
+QStringList photos(Jpeg kind, qint64 size, int count, bool writable = false);
+
+/// the content photos(kind, size, count) are generated with
+QByteArray photo(Jpeg kind, qint64 size);
+
+QString lastError();
+
+/// reports throughput: \a counter (e.g. "points/s") per second plus bytes/s unless \a bytes is 0
+void setRates(benchmark::State& state, const char* counter, qint64 items, qint64 bytes);
+
+} // namespace Fixtures
+
+#endif // BENCH_FIXTURES_H
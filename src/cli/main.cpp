@@ -0,0 +1,168 @@
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <cstdio>
+
+#include "gpx/collection.h"
+#include "gpx/matcher.h"
+#include "jpeg/loader.h"
+#include "jpeg/saver.h"
+
+/* Headless batch geotagger: loads the tracks and the photos, guesses the photo positions
+   and writes them, printing one JSON object per photo to stdout. Logs go to stderr. */
+
+namespace
+{
+
+enum ExitCode { Success = 0, Failure = 1, Usage = 2 };
+
+QStringList photosIn(const QString& path)
+{
+    QFileInfo info(path);
+    if (!info.isDir())
+        return { info.absoluteFilePath() };
+
+    QStringList photos;
+    QDirIterator i(info.absoluteFilePath(), { "*.jpg", "*.jpeg", "*.JPG", "*.JPEG" },
+                   QDir::Files, QDirIterator::Subdirectories | QDirIterator::FollowSymlinks);
+    while (i.hasNext())
+        photos.append(i.next());
+    return photos;
+}
+
+void print(QTextStream& out, const QJsonObject& object)
+{
+    out << QJsonDocument(object).toJson(QJsonDocument::Compact) << '\n';
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    app.setOrganizationName("sonnayasomnambula");
+    app.setOrganizationDomain("sonnayasomnambula.github.io");
+    app.setApplicationName("geotagger-cli");
+    app.setApplicationVersion("0.2");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes GPS positions guessed from the tracks into the photos' EXIF.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption trackOption({ "t", "track" }, "GPX track file, may be repeated.", "file");
+    QCommandLineOption offsetOption({ "o", "offset" }, "Photo time adjustment in seconds.", "seconds", "0");
+    QCommandLineOption maxGapOption({ "g", "max-gap" }, "Longest break between track segments to interpolate over, seconds.",
+                                    "seconds", QString::number(GPX::Matcher::DefaultMaxGap / 1000));
+    QCommandLineOption threadsOption({ "j", "threads" }, "Number of threads for reading and writing.", "count");
+    QCommandLineOption dryRunOption({ "n", "dry-run" }, "Guess the positions, but don't write them.");
+    parser.addOptions({ trackOption, offsetOption, maxGapOption, threadsOption, dryRunOption });
+    parser.addPositionalArgument("photos", "Photo files or directories (searched recursively).", "photos...");
+    parser.process(app);
+
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+
+    bool ok = true;
+    bool gapOk = true;
+    const qint64 offset = parser.value(offsetOption).toLongLong(&ok);
+    const qint64 maxGap = parser.value(maxGapOption).toLongLong(&gapOk);
+    const int threads = parser.isSet(threadsOption) ? parser.value(threadsOption).toInt() : 0;
+    if (!ok || !gapOk || maxGap < 0 || threads < 0 || parser.values(trackOption).isEmpty() || parser.positionalArguments().isEmpty()) {
+        err << parser.helpText();
+        return Usage;
+    }
+
+    GPX::Collection tracks;
+    if (threads)
+        tracks.setThreadCount(threads);
+    if (!tracks.load(parser.values(trackOption)) || !tracks.errors().isEmpty()) {
+        err << tracks.errors().join('\n') << '\n';
+        return Failure;
+    }
+
+    GPX::Matcher matcher;
+    matcher.setMaxGap(maxGap * 1000);
+    matcher.setTrack(tracks.track());
+
+    QStringList fileNames;
+    for (const QString& path: parser.positionalArguments())
+        fileNames += photosIn(path);
+
+    jpeg::Loader loader;
+    loader.setThumbnails(false);
+    if (threads)
+        loader.setThreadCount(threads);
+    loader.load(fileNames);
+    for (const QString& error: qAsConst(loader.errors))
+        print(out, { { "status", "error" }, { "error", error } });
+
+    QList<jpeg::Photo> photos = loader.loaded;
+    QVector<qint64> times;
+    for (const jpeg::Photo& photo: qAsConst(photos))
+        times.append(photo.time.addSecs(offset).toMSecsSinceEpoch());
+
+    const QVector<GPX::Matcher::Match> matches = matcher.find(times);
+    for (int i = 0; i < photos.size(); ++i)
+    {
+        jpeg::Photo& photo = photos[i];
+        // unlike the GUI, the file time is not trusted here
+        if (photo.flags.haveGPSCoord || !photo.flags.haveShotTime || !matches[i].isValid())
+            continue;
+
+        const QGeoCoordinate position = matcher.position(matches[i], times[i]);
+        photo.setPosition(position);
+        if (position.type() == QGeoCoordinate::Coordinate3D)
+            photo.altitude = position.altitude();
+        photo.flags.coordGuessed = true;
+    }
+
+    jpeg::Saver saver;
+    if (threads)
+        saver.setThreadCount(threads);
+    if (!parser.isSet(dryRunOption))
+        saver.save(photos, offset);
+
+    int tagged = 0;
+    for (int i = 0; i < photos.size(); ++i)
+    {
+        const jpeg::Photo& photo = photos[i];
+
+        QJsonObject result {
+            { "path", photo.path },
+            { "time", photo.time.addSecs(offset).toString(Qt::ISODate) },
+        };
+
+        if (photo.flags.coordGuessed || photo.flags.haveGPSCoord) {
+            result["lat"] = photo.lat();
+            result["lon"] = photo.lon();
+        }
+
+        if (photo.flags.haveGPSCoord)
+            result["status"] = "has-gps";
+        else if (!photo.flags.haveShotTime)
+            result["status"] = "no-shot-time";
+        else if (!photo.flags.coordGuessed)
+            result["status"] = "beyond-track";
+        else if (!saver.error(i).isEmpty()) {
+            result["status"] = "error";
+            result["error"] = saver.error(i);
+        } else {
+            result["status"] = parser.isSet(dryRunOption) ? "matched" : "tagged";
+            ++tagged;
+        }
+
+        print(out, result);
+    }
+
+    err << tagged << " of " << photos.size() << " photo(s) "
+        << (parser.isSet(dryRunOption) ? "matched" : "tagged") << '\n';
+
+    return loader.errors.isEmpty() && saver.errors.isEmpty() ? Success : Failure;
+}
@@ -1,14 +1,17 @@
 #include <QDebug>
+#include <QFile>
+#include <QSaveFile>
 #include <QVector>
 
+#include <algorithm>
 #include <cstdio>
+#include <cstdlib>
 
 #include <libexif/exif-content.h>
 #include <libexif/exif-data.h>
-#include <libexif/exif-loader.h>
-#include <libjpeg/jpeg-data.h>
 
 #include "exif/file.h"
+#include "exif/jpeg.h"
 
 void Exif::File::log(ExifLog* /*log*/, ExifLogCode code, const char* domain, const char* format, va_list args, void* self)
 {
@@ -31,6 +34,7 @@ Exif::File::File()
 
 Exif::File::~File()
 {
+    exif_data_unref(mExifData);
     exif_log_unref(mLog);
     exif_mem_unref(mAllocator);
 }
@@ -42,51 +46,42 @@ bool Exif::File::load(const QString& fileName, bool createIfEmpty)
 {
     mFileName = fileName;
 
-    std::wstring ws = mFileName.toStdWString();
-    const wchar_t* path = ws.c_str();
-
-    // here some copy-paste from exif-data.c modified to support wchar_t
+    // the tags of the file loaded before
+    if (mExifData) {
+        exif_data_unref(mExifData);
+        mExifData = nullptr;
+    }
 
     {
-        // exif_data_new_from_file
-
-        ExifData *edata;
-        ExifLoader *loader;
-
-        loader = exif_loader_new ();
-
-        {
-            // exif_loader_write_file
-
-            FILE *f;
-            int size;
-            unsigned char data[1024];
-
-            if (!loader || !path)
-                return false;
+        // only the APP1 segment is read: the markers before it are walked
+        // and the segment itself is taken with a single read, the image data is never touched
+
+        QFile file(mFileName);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered)) {
+            mErrorString = QString("[%1] The file '%2' could not be opened.")
+                               .arg("ExifLoader")
+                               .arg(mFileName);
+            qWarning().noquote() << mErrorString;
+            return false;
+        }
 
-            f = _wfopen (path, L"rb");
-            if (!f) {
-                mErrorString = QString("[%1] The file '%2' could not be opened.")
+        const Jpeg::Segment app1 = Jpeg::findApp1(file);
+        if (app1.isValid()) {
+            QByteArray data(app1.size, Qt::Uninitialized);
+            if (!Jpeg::readAt(file, app1.payload(), data.data(), data.size())) {
+                mErrorString = QString("[%1] Could not read '%2'.")
                                    .arg("ExifLoader")
-                                   .arg(path);
+                                   .arg(mFileName);
                 qWarning().noquote() << mErrorString;
                 return false;
             }
-            while (1) {
-                size = fread (data, 1, sizeof (data), f);
-                if (size <= 0)
-                    break;
-                if (!exif_loader_write (loader, data, size))
-                    break;
-            }
-            fclose (f);
-        }
-
-        edata = exif_loader_get_data (loader);
-        exif_loader_unref (loader);
 
-        mExifData = edata;
+            mExifData = exif_data_new_mem(mAllocator);
+            if (mLog)
+                exif_data_log(mExifData, mLog);
+            exif_data_load_data(mExifData, reinterpret_cast<const unsigned char*>(data.constData()),
+                                static_cast<unsigned int>(data.size()));
+        }
     }
 
     if (!mExifData)
@@ -105,90 +100,93 @@ bool Exif::File::load(const QString& fileName, bool createIfEmpty)
     return mExifData;
 }
 
+/// \brief write the tags to \a fileName
+/// If the new EXIF data fits in the existing APP1 segment, only the segment is rewritten in place;
+/// otherwise the file is rebuilt around the new segment in a temporary file, which then replaces
+/// the original one, so the file is never lost if something goes wrong halfway.
 bool Exif::File::save(const QString& fileName)
 {
-    JPEGData *data = jpeg_data_new ();
+    static const int Slack = 512;
 
-    if (mLog)
-        jpeg_data_log(data, mLog);
-
-    std::wstring ws = fileName.toStdWString();
-    const wchar_t* path = ws.data();
-
-    // here some copy-paste from jpeg-data.c modified to support wchar_t
+    auto fail = [this](const QString& message) {
+        mErrorString = QString("[%1] %2").arg("jpeg-data").arg(message);
+        qWarning().noquote() << mErrorString;
+        return false;
+    };
 
+    QByteArray exif;
     {
-        // jpeg_data_load_file
-
-        FILE *f;
-        unsigned char *d;
-        unsigned int size;
-
-        if (!data) return false;
-        if (!path) return false;
-
-        f = _wfopen (path, L"rb");
-        if (!f) {
-            mErrorString = QString("[%1] Path '%2' invalid.")
-                               .arg("jpeg-data")
-                               .arg(path);
-            qWarning().noquote() << mErrorString;
-            return false;
-        }
+        unsigned char *d = NULL;
+        unsigned int size = 0;
 
-        /* For now, we read the data into memory. Patches welcome... */
-        fseek (f, 0, SEEK_END);
-        size = ftell (f);
-        fseek (f, 0, SEEK_SET);
-        d = (unsigned char*) malloc (size);
-        if (!d) {
-            EXIF_LOG_NO_MEMORY (mLog, "jpeg-data", size);
-            fclose (f);
-            return false;
-        }
-        if (fread (d, 1, size, f) != size) {
-            free (d);
-            fclose (f);
-            mErrorString = QString("[%1] Could not read '%2'.")
-                               .arg("jpeg-data")
-                               .arg(path);
-            qWarning().noquote() << mErrorString;
-            return false;
-        }
-        fclose (f);
+        exif_data_save_data (mExifData, &d, &size);
+        if (!d)
+            return fail(QString("Could not serialize EXIF data for '%1'.").arg(fileName));
 
-        jpeg_data_load_data (data, d, size);
+        exif = QByteArray(reinterpret_cast<const char*>(d), static_cast<int>(size));
         free (d);
     }
 
-    jpeg_data_set_exif_data(data, mExifData);
+    if (exif.size() > Jpeg::MaxPayload)
+        return fail(QString("EXIF data for '%1' is too large (%2 bytes).").arg(fileName).arg(exif.size()));
 
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Unbuffered))
+        return fail(QString("Path '%1' invalid.").arg(fileName));
+
+    const Jpeg::Segment app1 = Jpeg::findApp1(file);
+
+    if (app1.isValid() && exif.size() <= app1.size)
     {
-        // jpeg_data_save_file
+        // fast path: same segment length, the rest of the segment is padded
+        exif.append(app1.size - exif.size(), '\0');
+        if (!Jpeg::writeAt(file, app1.payload(), exif.constData(), exif.size()))
+            return fail(QString("Could not write '%1': %2").arg(fileName, file.errorString()));
+        return true;
+    }
 
-        FILE *f;
-        unsigned char *d = NULL;
-        unsigned int size = 0, written;
+    // replace the existing segment or insert a new one;
+    // libexif output is usually a bit larger than the camera's one, so some room is reserved
+    // for the GPS tags to let the following saves take the fast path
+    exif.append(std::min(Slack, Jpeg::MaxPayload - exif.size()), '\0');
 
-        jpeg_data_save_data (data, &d, &size);
-        if (!d)
-            return false;
+    const qint64 head = app1.isValid() ? app1.offset : Jpeg::insertionPoint(file);
+    const qint64 tail = app1.isValid() ? app1.end() : head;
+    if (head < 0)
+        return fail(QString("'%1' is not a JPEG file.").arg(fileName));
 
-        _wremove (path);
-        f = _wfopen (path, L"wb");
-        if (!f) {
-            free (d);
-            return false;
-        }
-        written = fwrite (d, 1, size, f);
-        fclose (f);
-        free (d);
-        if (written == size)  {
-            return true;
+    QSaveFile spliced(fileName);
+    if (!spliced.open(QIODevice::WriteOnly))
+        return fail(QString("Could not create '%1': %2").arg(fileName, spliced.errorString()));
+
+    auto copy = [&file, &spliced](qint64 from, qint64 to) {
+        QByteArray buffer(std::min<qint64>(to - from, 1 << 20), Qt::Uninitialized);
+        for (qint64 offset = from; offset < to; offset += buffer.size())
+        {
+            const qint64 size = std::min<qint64>(to - offset, buffer.size());
+            if (!Jpeg::readAt(file, offset, buffer.data(), size) || spliced.write(buffer.constData(), size) != size)
+                return false;
         }
-        _wremove(path);
-        return false;
+        return true;
+    };
+
+    const int length = exif.size() + 2;
+    const char marker[] = { '\xFF', '\xE1', static_cast<char>(length >> 8), static_cast<char>(length & 0xFF) };
+
+    if (!copy(0, head) ||
+        spliced.write(marker, sizeof(marker)) != sizeof(marker) ||
+        spliced.write(exif) != exif.size() ||
+        !copy(tail, file.size()))
+    {
+        spliced.cancelWriting();
+        return fail(QString("Could not write '%1': %2").arg(fileName, spliced.errorString()));
     }
+
+    file.close(); // the original is replaced on commit
+    if (!spliced.commit())
+        return fail(QString("Could not replace '%1': %2").arg(fileName, spliced.errorString()));
+
+    return true;
 }
 
 void Exif::File::setValue(ExifIfd ifd, ExifTag tag, const QVector<ExifRational> urational)
@@ -0,0 +1,145 @@
+#include "exif/jpeg.h"
+
+#include <QFileDevice>
+
+#include <cstring>
+
+#ifdef Q_OS_UNIX
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+namespace
+{
+
+enum Marker : uchar
+{
+    SOI  = 0xD8,
+    EOI  = 0xD9,
+    SOS  = 0xDA,
+    APP0 = 0xE0,
+    APP1 = 0xE1,
+    TEM  = 0x01,
+    RST0 = 0xD0,
+    RST7 = 0xD7,
+};
+
+const char ExifHeader[] = { 'E', 'x', 'i', 'f', 0, 0 };
+
+bool isStandalone(uchar marker)
+{
+    return marker == TEM || (marker >= RST0 && marker <= RST7);
+}
+
+/// walks the segments before the image data; \a visit returns true to stop
+template <class Visitor>
+Exif::Jpeg::Segment walk(QFileDevice& file, Visitor visit)
+{
+    uchar header[4];
+    if (!Exif::Jpeg::readAt(file, 0, reinterpret_cast<char*>(header), 2) || header[0] != 0xFF || header[1] != SOI)
+        return {};
+
+    const qint64 fileSize = file.size();
+    qint64 offset = 2;
+    while (offset + 4 <= fileSize)
+    {
+        if (!Exif::Jpeg::readAt(file, offset, reinterpret_cast<char*>(header), 4) || header[0] != 0xFF)
+            return {};
+
+        const uchar marker = header[1];
+        if (marker == 0xFF) { // fill byte
+            ++offset;
+            continue;
+        }
+        if (marker == SOS || marker == EOI)
+            return {};
+        if (isStandalone(marker)) {
+            offset += 2;
+            continue;
+        }
+
+        Exif::Jpeg::Segment segment;
+        segment.offset = offset;
+        segment.size = ((header[2] << 8) | header[3]) - 2;
+        if (segment.size < 0 || segment.end() > fileSize)
+            return {};
+
+        if (visit(marker, segment))
+            return segment;
+
+        offset = segment.end();
+    }
+
+    return {};
+}
+
+} // namespace
+
+
+/// reads exactly \a size bytes at \a offset without moving the file position
+bool Exif::Jpeg::readAt(QFileDevice& file, qint64 offset, char* data, qint64 size)
+{
+#ifdef Q_OS_UNIX
+    const int fd = file.handle();
+    qint64 done = 0;
+    while (done < size)
+    {
+        ssize_t n = ::pread(fd, data + done, static_cast<size_t>(size - done), offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+#else
+    return file.seek(offset) && file.read(data, size) == size;
+#endif
+}
+
+/// writes exactly \a size bytes at \a offset without moving the file position
+bool Exif::Jpeg::writeAt(QFileDevice& file, qint64 offset, const char* data, qint64 size)
+{
+#ifdef Q_OS_UNIX
+    const int fd = file.handle();
+    qint64 done = 0;
+    while (done < size)
+    {
+        ssize_t n = ::pwrite(fd, data + done, static_cast<size_t>(size - done), offset + done);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        done += n;
+    }
+    return true;
+#else
+    return file.seek(offset) && file.write(data, size) == size;
+#endif
+}
+
+/// \return the APP1 segment holding EXIF data (there may be XMP APP1 as well),
+/// an invalid segment if there is none before the image data
+Exif::Jpeg::Segment Exif::Jpeg::findApp1(QFileDevice& file)
+{
+    return walk(file, [&file](uchar marker, const Segment& segment) {
+        if (marker != APP1 || segment.size < static_cast<int>(sizeof(ExifHeader)))
+            return false;
+        char header[sizeof(ExifHeader)];
+        return readAt(file, segment.payload(), header, sizeof(header)) &&
+               memcmp(header, ExifHeader, sizeof(header)) == 0;
+    });
+}
+
+/// \return where a new APP1 segment should be placed: after JFIF APP0 if any, after SOI otherwise;
+/// -1 if the file is not a JPEG
+qint64 Exif::Jpeg::insertionPoint(QFileDevice& file)
+{
+    uchar soi[2];
+    if (!readAt(file, 0, reinterpret_cast<char*>(soi), 2) || soi[0] != 0xFF || soi[1] != SOI)
+        return -1;
+
+    uchar marker = 0;
+    const Segment first = walk(file, [&marker](uchar m, const Segment&) { marker = m; return true; });
+    return first.isValid() && first.offset == 2 && marker == APP0 ? first.end() : 2;
+}
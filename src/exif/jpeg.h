@@ -0,0 +1,38 @@
+#ifndef EXIF_JPEG_H
+#define EXIF_JPEG_H
+
+#include <QtGlobal>
+
+class QFileDevice;
+
+namespace Exif {
+
+/// Minimal JPEG structure walker: finds segments by reading the marker headers only,
+/// never touching the entropy-coded image data.
+namespace Jpeg {
+
+/// a marker segment in the file
+struct Segment
+{
+    qint64 offset = -1; // of the 0xFF marker byte
+    int size = 0;       // of the payload, without the marker and the length field
+
+    bool isValid() const { return offset >= 0; }
+    qint64 payload() const { return offset + 4; }
+    qint64 end() const { return payload() + size; }
+};
+
+/// largest payload a segment may have, as its 16 bit length includes the length field itself
+static const int MaxPayload = 0xFFFF - 2;
+
+bool readAt(QFileDevice& file, qint64 offset, char* data, qint64 size);
+bool writeAt(QFileDevice& file, qint64 offset, const char* data, qint64 size);
+
+Segment findApp1(QFileDevice& file);
+qint64 insertionPoint(QFileDevice& file);
+
+} // namespace Jpeg
+
+} // namespace Exif
+
+#endif // EXIF_JPEG_H
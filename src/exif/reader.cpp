@@ -0,0 +1,265 @@
+#include "exif/reader.h"
+
+#include <QDebug>
+#include <QFile>
+
+#include <algorithm>
+#include <cstring>
+
+#include "exif/jpeg.h"
+
+namespace
+{
+
+const char ExifHeader[] = { 'E', 'x', 'i', 'f', 0, 0 };
+
+const int EntrySize = 12;
+
+enum Pointer : quint16
+{
+    ExifIfdPointer    = 0x8769,
+    GpsIfdPointer     = 0x8825,
+    InteropIfdPointer = 0xA005,
+    ThumbnailOffset   = 0x0201, // JPEGInterchangeFormat in IFD1
+    ThumbnailLength   = 0x0202,
+};
+
+/// bytes per component of the TIFF field types, 0 for unknown ones
+int formatSize(quint16 format)
+{
+    switch (format) {
+    case 1: case 2: case 6: case 7: return 1; // BYTE, ASCII, SBYTE, UNDEFINED
+    case 3: case 8: return 2;                 // SHORT, SSHORT
+    case 4: case 9: case 11: case 13: return 4; // LONG, SLONG, FLOAT, IFD
+    case 5: case 10: case 12: return 8;       // RATIONAL, SRATIONAL, DOUBLE
+    default: return 0;
+    }
+}
+
+const quint16 FormatShort = 3;
+const quint16 FormatLong = 4;
+const quint16 FormatRational = 5;
+
+} // namespace
+
+Exif::Reader::Reader()
+{
+    std::fill(mIfd, mIfd + EXIF_IFD_COUNT, -2);
+}
+
+bool Exif::Reader::fail(const QString& message)
+{
+    mErrorString = QString("[%1] %2").arg("ExifReader").arg(message);
+    qWarning().noquote() << mErrorString;
+    return false;
+}
+
+/// \brief read the APP1 segment of \a fileName, nothing else is read or parsed;
+/// a file without EXIF is loaded as an empty one
+bool Exif::Reader::load(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return fail(QString("The file '%1' could not be opened.").arg(fileName));
+
+    const Jpeg::Segment app1 = Jpeg::findApp1(file);
+    if (!app1.isValid())
+        return load(QByteArray());
+
+    QByteArray data(app1.size, Qt::Uninitialized);
+    if (!Jpeg::readAt(file, app1.payload(), data.data(), data.size()))
+        return fail(QString("Could not read '%1'.").arg(fileName));
+
+    return load(data);
+}
+
+/// \brief take the APP1 payload starting with the "Exif\0\0" header;
+/// a malformed one is reported and loaded as an empty one, as libexif does
+bool Exif::Reader::load(const QByteArray& app1)
+{
+    mData.clear();
+    mTiffSize = 0;
+    std::fill(mIfd, mIfd + EXIF_IFD_COUNT, -2);
+
+    if (app1.isEmpty())
+        return true;
+
+    if (app1.size() < HeaderSize + 8 || memcmp(app1.constData(), ExifHeader, sizeof(ExifHeader)) != 0) {
+        fail("Not an EXIF segment.");
+        return true;
+    }
+
+    // kept as it is, the TIFF structure is read in place
+    mData = app1;
+    const char* tiff = this->tiff();
+    if (memcmp(tiff, "II", 2) != 0 && memcmp(tiff, "MM", 2) != 0) {
+        mData.clear();
+        fail("Unknown byte order.");
+        return true;
+    }
+
+    mBigEndian = tiff[0] == 'M';
+    if (u16(2) != 42) {
+        mData.clear();
+        fail("Not a TIFF structure.");
+        return true;
+    }
+
+    mTiffSize = mData.size() - HeaderSize;
+    return true;
+}
+
+quint16 Exif::Reader::u16(qint64 offset) const
+{
+    const uchar* d = reinterpret_cast<const uchar*>(tiff()) + offset;
+    return mBigEndian ? quint16((d[0] << 8) | d[1]) : quint16((d[1] << 8) | d[0]);
+}
+
+quint32 Exif::Reader::u32(qint64 offset) const
+{
+    const uchar* d = reinterpret_cast<const uchar*>(tiff()) + offset;
+    return mBigEndian ? (quint32(d[0]) << 24) | (quint32(d[1]) << 16) | (quint32(d[2]) << 8) | d[3]
+                      : (quint32(d[3]) << 24) | (quint32(d[2]) << 16) | (quint32(d[1]) << 8) | d[0];
+}
+
+/// \return the offset of \a ifd, following the pointers from IFD0 the first time it's asked for
+qint64 Exif::Reader::ifd(ExifIfd ifd) const
+{
+    if (ifd < 0 || ifd >= EXIF_IFD_COUNT || mTiffSize == 0)
+        return -1;
+
+    qint64& offset = mIfd[ifd];
+    if (offset != -2)
+        return offset;
+
+    offset = -1;
+
+    auto pointer = [this](ExifIfd parent, quint16 tag) -> qint64 {
+        Entry entry;
+        if (!find(parent, static_cast<ExifTag>(tag), &entry) || entry.size != 4)
+            return -1;
+        return u32(entry.data - tiff());
+    };
+
+    qint64 at = -1;
+    switch (ifd) {
+    case EXIF_IFD_0:
+        at = u32(4);
+        break;
+    case EXIF_IFD_1: {
+        const qint64 ifd0 = this->ifd(EXIF_IFD_0);
+        if (ifd0 >= 0)
+            at = u32(ifd0 + 2 + qint64(u16(ifd0)) * EntrySize);
+        break;
+    }
+    case EXIF_IFD_EXIF:
+        at = pointer(EXIF_IFD_0, ExifIfdPointer);
+        break;
+    case EXIF_IFD_GPS:
+        at = pointer(EXIF_IFD_0, GpsIfdPointer);
+        break;
+    case EXIF_IFD_INTEROPERABILITY:
+        at = pointer(EXIF_IFD_EXIF, InteropIfdPointer);
+        break;
+    default:
+        break;
+    }
+
+    // the entries and the next IFD offset must fit
+    if (at >= 8 && at + 2 <= mTiffSize && at + 2 + qint64(u16(at)) * EntrySize + 4 <= mTiffSize)
+        offset = at;
+    return offset;
+}
+
+/// looks \a tag up in the entries of \a ifd, the value is not copied
+bool Exif::Reader::find(ExifIfd ifd, ExifTag tag, Entry* entry) const
+{
+    const qint64 at = this->ifd(ifd);
+    if (at < 0)
+        return false;
+
+    const int count = u16(at);
+    for (int i = 0; i < count; ++i)
+    {
+        const qint64 e = at + 2 + qint64(i) * EntrySize;
+        if (u16(e) != tag)
+            continue;
+
+        entry->format = u16(e + 2);
+        entry->components = u32(e + 4);
+
+        const qint64 size = qint64(formatSize(entry->format)) * entry->components;
+        if (size == 0 || size > mTiffSize)
+            return false;
+
+        const qint64 offset = size <= 4 ? e + 8 : u32(e + 8);
+        if (offset + size > mTiffSize)
+            return false;
+
+        entry->data = tiff() + offset;
+        entry->size = static_cast<int>(size);
+        return true;
+    }
+
+    return false;
+}
+
+QVector<ExifRational> Exif::Reader::uRationalVector(ExifIfd ifd, ExifTag tag) const
+{
+    QVector<ExifRational> value;
+    Entry entry;
+    if (!find(ifd, tag, &entry) || entry.format != FormatRational)
+        return value;
+
+    const qint64 offset = entry.data - tiff();
+    value.reserve(static_cast<int>(entry.components));
+    for (quint32 i = 0; i < entry.components; ++i)
+    {
+        ExifRational rational;
+        rational.numerator = u32(offset + i * 8);
+        rational.denominator = u32(offset + i * 8 + 4);
+        value.append(rational);
+    }
+
+    return value;
+}
+
+/// \return the raw bytes of the tag value without the trailing '\0', like File::ascii
+QByteArray Exif::Reader::ascii(ExifIfd ifd, ExifTag tag) const
+{
+    Entry entry;
+    if (!find(ifd, tag, &entry))
+        return {};
+
+    QByteArray d(entry.data, entry.size);
+    if (d.endsWith('\0'))
+        d.resize(d.size() - 1);
+    return d;
+}
+
+/// \return the value of a single SHORT or LONG tag, -1 if there is none
+qint64 Exif::Reader::number(ExifIfd ifd, quint16 tag) const
+{
+    Entry entry;
+    if (!find(ifd, static_cast<ExifTag>(tag), &entry) || entry.components != 1)
+        return -1;
+
+    const qint64 offset = entry.data - tiff();
+    if (entry.format == FormatShort)
+        return u16(offset);
+    if (entry.format == FormatLong)
+        return u32(offset);
+    return -1;
+}
+
+/// \return the JPEG thumbnail of IFD1, a slice of the loaded segment:
+/// not copied, valid while the reader is alive and not loaded again
+QByteArray Exif::Reader::thumbnail() const
+{
+    const qint64 offset = number(EXIF_IFD_1, ThumbnailOffset);
+    const qint64 length = number(EXIF_IFD_1, ThumbnailLength);
+    if (offset < 8 || length <= 0 || offset + length > mTiffSize)
+        return {};
+
+    return QByteArray::fromRawData(tiff() + offset, static_cast<int>(length));
+}
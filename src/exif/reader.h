@@ -0,0 +1,61 @@
+#ifndef EXIF_READER_H
+#define EXIF_READER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include <libexif/exif-ifd.h>
+#include <libexif/exif-tag.h>
+#include <libexif/exif-utils.h>
+
+namespace Exif {
+
+/// Read-only access to a few tags, straight from the TIFF structure of the APP1 segment.
+/// Unlike File, nothing is parsed on load: an IFD is located only when one of its tags
+/// is requested (IFD0 -> Exif IFD / GPS IFD), and only the requested entry is decoded.
+/// No libexif objects are created; use File to change the tags.
+class Reader
+{
+    static const int HeaderSize = 6; // "Exif\0\0" before the TIFF structure
+
+    QByteArray mData; // the APP1 payload
+    int mTiffSize = 0; // 0 if there is no valid TIFF structure
+    bool mBigEndian = false;
+    mutable qint64 mIfd[EXIF_IFD_COUNT]; // offsets in the TIFF structure, -1 if absent, -2 if not looked up yet
+
+    QString mErrorString;
+
+    struct Entry
+    {
+        quint16 format = 0;
+        quint32 components = 0;
+        const char* data = nullptr;
+        int size = 0;
+    };
+
+    const char* tiff() const { return mData.constData() + HeaderSize; }
+    quint16 u16(qint64 offset) const;
+    quint32 u32(qint64 offset) const;
+    qint64 ifd(ExifIfd ifd) const;
+    bool find(ExifIfd ifd, ExifTag tag, Entry* entry) const;
+    qint64 number(ExifIfd ifd, quint16 tag) const;
+    bool fail(const QString& message);
+
+public:
+    Reader();
+
+    bool load(const QString& fileName);
+    bool load(const QByteArray& app1);
+
+    QVector<ExifRational> uRationalVector(ExifIfd ifd, ExifTag tag) const;
+    QByteArray ascii(ExifIfd ifd, ExifTag tag) const;
+
+    QByteArray thumbnail() const;
+
+    const QString& errorString() const { return mErrorString; }
+};
+
+} // namespace Exif
+
+#endif // EXIF_READER_H
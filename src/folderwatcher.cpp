@@ -0,0 +1,318 @@
+#include "folderwatcher.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include "task.h"
+
+namespace
+{
+
+const quint32 Magic = 0x67746677; // "gtfw"
+const quint32 Version = 1;
+
+const int Delay = 500; // ms, notifications come in bursts while files are copied
+
+bool isJpeg(const QFileInfo& file)
+{
+    return file.suffix().compare("jpg", Qt::CaseInsensitive) == 0 ||
+           file.suffix().compare("jpeg", Qt::CaseInsensitive) == 0;
+}
+
+} // namespace
+
+QDataStream& operator<<(QDataStream& stream, const FolderWatcher::File& file)
+{
+    return stream << file.size << file.modified;
+}
+
+QDataStream& operator>>(QDataStream& stream, FolderWatcher::File& file)
+{
+    return stream >> file.size >> file.modified;
+}
+
+QDataStream& operator<<(QDataStream& stream, const FolderWatcher::Directory& directory)
+{
+    return stream << directory.modified << directory.files << directory.subdirs;
+}
+
+QDataStream& operator>>(QDataStream& stream, FolderWatcher::Directory& directory)
+{
+    return stream >> directory.modified >> directory.files >> directory.subdirs;
+}
+
+FolderWatcher::FolderWatcher(QObject* parent) : QObject(parent)
+{
+    mPool.setMaxThreadCount(1);
+
+    mTimer.setSingleShot(true);
+    mTimer.setInterval(Delay);
+    connect(&mTimer, &QTimer::timeout, this, &FolderWatcher::start);
+
+    connect(&mWatcher, &QFileSystemWatcher::directoryChanged, this, [this](const QString& path){
+        mDirty.insert(path);
+        mTimer.start();
+    });
+}
+
+QString FolderWatcher::defaultFileName()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("folders.index");
+}
+
+/// starts following \a path; the photos in it not known yet are reported in the background
+void FolderWatcher::addFolder(const QString& path)
+{
+    const QString folder = QFileInfo(path).absoluteFilePath();
+    if (!mFolders.contains(folder))
+        mFolders.append(folder);
+
+    mFull = true;
+    start();
+}
+
+/// walks all the folders, e.g. after load()
+void FolderWatcher::rescan()
+{
+    mFull = true;
+    start();
+}
+
+/// walks all the folders as if for the first time, every file found is reported as created
+void FolderWatcher::relist()
+{
+    ++mGeneration; // a scan running has the old index
+    mIndex.clear();
+    mDirty.clear();
+
+    if (!mWatcher.directories().isEmpty())
+        mWatcher.removePaths(mWatcher.directories());
+
+    rescan();
+}
+
+/// forgets the folders and the index, nothing is reported
+void FolderWatcher::clear()
+{
+    ++mGeneration;
+    mFolders.clear();
+    mIndex.clear();
+    mDirty.clear();
+    mFull = false;
+    mTimer.stop();
+
+    if (!mWatcher.directories().isEmpty())
+        mWatcher.removePaths(mWatcher.directories());
+}
+
+void FolderWatcher::start()
+{
+    if (mScanning || (!mFull && mDirty.isEmpty()))
+        return; // started again when the current one is done
+
+    const QStringList folders = mFolders;
+    const QSet<QString> dirty = mDirty;
+    const bool full = mFull;
+    const int generation = mGeneration;
+    mDirty.clear();
+    mFull = false;
+    mScanning = true;
+
+    Delta delta;
+    delta.index = mIndex; // implicitly shared, detached by the scan
+
+    run(&mPool, [this, delta, folders, dirty, full, generation]() mutable {
+        if (full) {
+            for (const QString& folder: folders)
+                scan(&delta, folder, true, false);
+        }
+        for (const QString& path: dirty) {
+            if (delta.index.contains(path))
+                scan(&delta, path, false, true);
+        }
+
+        QMetaObject::invokeMethod(this, [this, delta, generation]{ onScanned(delta, generation); }, Qt::QueuedConnection);
+    });
+}
+
+void FolderWatcher::onScanned(const Delta& delta, int generation)
+{
+    mScanning = false;
+
+    if (generation == mGeneration)
+    {
+        QStringList watched;
+        for (auto i = delta.index.cbegin(); i != delta.index.cend(); ++i)
+            if (!mIndex.contains(i.key()))
+                watched.append(i.key());
+
+        QStringList unwatched;
+        for (auto i = mIndex.cbegin(); i != mIndex.cend(); ++i)
+            if (!delta.index.contains(i.key()))
+                unwatched.append(i.key());
+
+        mIndex = delta.index;
+        if (!unwatched.isEmpty())
+            mWatcher.removePaths(unwatched);
+        if (!watched.isEmpty())
+            mWatcher.addPaths(watched);
+
+        if (!delta.created.isEmpty() || !delta.modified.isEmpty() || !delta.removed.isEmpty())
+        {
+            qInfo() << "FolderWatcher:" << delta.created.size() << "created," << delta.modified.size() << "modified,"
+                    << delta.removed.size() << "removed";
+            emit changed(delta.created, delta.modified, delta.removed);
+        }
+    }
+
+    start();
+}
+
+/// lists \a path again if it's modified since the last time (or \a force) and reports the difference;
+/// the subdirectories are walked if \a recursive, the new ones always
+void FolderWatcher::scan(Delta* delta, const QString& path, bool recursive, bool force)
+{
+    const QFileInfo info(path);
+    if (!info.isDir())
+        return drop(delta, path);
+
+    // a copy, the index may be rehashed by the nested calls
+    Directory directory = delta->index.value(path);
+    const qint64 modified = info.lastModified().toMSecsSinceEpoch();
+
+    if (force || directory.modified != modified)
+    {
+        Directory listed;
+        listed.modified = modified;
+
+        QDirIterator i(path, QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+        while (i.hasNext())
+        {
+            i.next();
+            const QFileInfo entry = i.fileInfo();
+            if (entry.isDir()) {
+                if (!entry.isSymLink()) // no loops
+                    listed.subdirs.append(entry.fileName());
+                continue;
+            }
+            if (!isJpeg(entry))
+                continue;
+
+            File file;
+            file.size = entry.size();
+            file.modified = entry.lastModified().toMSecsSinceEpoch();
+            listed.files.insert(entry.fileName(), file);
+
+            auto known = directory.files.constFind(entry.fileName());
+            if (known == directory.files.cend())
+                delta->created.append(entry.absoluteFilePath());
+            else if (known->size != file.size || known->modified != file.modified)
+                delta->modified.append(entry.absoluteFilePath());
+        }
+
+        for (auto known = directory.files.cbegin(); known != directory.files.cend(); ++known)
+            if (!listed.files.contains(known.key()))
+                delta->removed.append(path + '/' + known.key());
+
+        for (const QString& name: qAsConst(directory.subdirs))
+            if (!listed.subdirs.contains(name))
+                drop(delta, path + '/' + name);
+
+        directory = listed;
+        delta->index.insert(path, directory);
+    }
+
+    for (const QString& name: qAsConst(directory.subdirs))
+    {
+        const QString subdir = path + '/' + name;
+        if (recursive || !delta->index.contains(subdir))
+            scan(delta, subdir, true, false);
+    }
+}
+
+/// forgets \a path with everything under it, its files are reported removed
+void FolderWatcher::drop(Delta* delta, const QString& path)
+{
+    const Directory directory = delta->index.take(path);
+
+    for (auto file = directory.files.cbegin(); file != directory.files.cend(); ++file)
+        delta->removed.append(path + '/' + file.key());
+
+    for (const QString& name: directory.subdirs)
+        drop(delta, path + '/' + name);
+}
+
+bool FolderWatcher::load(const QString& fileName)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != Magic || version != Version) {
+        qInfo() << "FolderWatcher:" << fileName << "is outdated, ignored";
+        return false;
+    }
+
+    QStringList folders;
+    Index index;
+    stream >> folders >> index;
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "FolderWatcher:" << fileName << "is corrupted, ignored";
+        return false;
+    }
+
+    clear();
+    mFolders = folders;
+    mIndex = index;
+    if (!mIndex.isEmpty())
+        mWatcher.addPaths(mIndex.keys());
+
+    qInfo() << "FolderWatcher:" << mFolders.size() << "folder(s)," << mIndex.size() << "directories loaded from" << fileName;
+    return true;
+}
+
+bool FolderWatcher::save(const QString& fileName) const
+{
+    return write(fileName, mFolders, mIndex);
+}
+
+bool FolderWatcher::saveFolders(const QString& fileName) const
+{
+    // with no directories known, the rescan after load() reports every file
+    return write(fileName, mFolders, {});
+}
+
+bool FolderWatcher::write(const QString& fileName, const QStringList& folders, const Index& index)
+{
+    QDir().mkpath(QFileInfo(fileName).absolutePath());
+
+    QSaveFile file(fileName);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_6);
+        stream << Magic << Version << folders << index;
+
+        if (file.commit())
+            return true;
+    }
+
+    qWarning() << "FolderWatcher: unable to write" << fileName << file.errorString();
+    return false;
+}
+
+bool FolderWatcher::remove(const QString& fileName)
+{
+    return !QFile::exists(fileName) || QFile::remove(fileName);
+}
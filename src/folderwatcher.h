@@ -0,0 +1,95 @@
+#ifndef FOLDERWATCHER_H
+#define FOLDERWATCHER_H
+
+#include <QFileSystemWatcher>
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+class QDataStream;
+
+/* Photo folders added once and then followed.
+   The JPEG files found under the folders are kept in an index along with the modification
+   times of their directories, and the index is kept between the runs. A rescan lists again only
+   the directories modified since, and only the differences are reported, so a large archive
+   with a few new photos costs a few photos. While the program runs, the directories are watched
+   and the changed ones are listed again. Files rewritten in place (not replaced) leave
+   the directory time as it is and are not noticed. */
+
+class FolderWatcher : public QObject
+{
+    Q_OBJECT
+
+signals:
+    /// absolute paths of the JPEG files found, changed and gone since the previous report
+    void changed(const QStringList& created, const QStringList& modified, const QStringList& removed);
+
+public:
+    explicit FolderWatcher(QObject* parent = nullptr);
+
+    static QString defaultFileName();
+
+    void addFolder(const QString& path);
+    void rescan();
+    void relist();
+    void clear();
+    const QStringList& folders() const { return mFolders; }
+
+    bool load(const QString& fileName = defaultFileName());
+    bool save(const QString& fileName = defaultFileName()) const;
+    /// the folders without the index, for a relisting after load()
+    bool saveFolders(const QString& fileName = defaultFileName()) const;
+    static bool remove(const QString& fileName = defaultFileName());
+
+private:
+    struct File
+    {
+        qint64 size = 0;
+        qint64 modified = 0; // msecs since epoch
+    };
+
+    struct Directory
+    {
+        qint64 modified = -1; // msecs since epoch, -1 if not listed yet
+        QHash<QString, File> files; // JPEG files by name
+        QStringList subdirs; // names
+    };
+
+    using Index = QHash<QString, Directory>; // by absolute path
+
+    struct Delta
+    {
+        Index index;
+        QStringList created;
+        QStringList modified;
+        QStringList removed;
+    };
+
+    friend QDataStream& operator<<(QDataStream& stream, const File& file);
+    friend QDataStream& operator>>(QDataStream& stream, File& file);
+    friend QDataStream& operator<<(QDataStream& stream, const Directory& directory);
+    friend QDataStream& operator>>(QDataStream& stream, Directory& directory);
+
+    static bool write(const QString& fileName, const QStringList& folders, const Index& index);
+    static void scan(Delta* delta, const QString& path, bool recursive, bool force);
+    static void drop(Delta* delta, const QString& path);
+
+    void start();
+    void onScanned(const Delta& delta, int generation);
+
+    QStringList mFolders;
+    Index mIndex; // replaced by the result of each scan
+    QSet<QString> mDirty; // directories to list again
+    bool mFull = false; // to walk all the folders, listing the modified directories only
+    bool mScanning = false;
+    int mGeneration = 0; // scans started before clear() are ignored
+
+    QFileSystemWatcher mWatcher;
+    QTimer mTimer; // a burst of notifications makes a single scan
+    QThreadPool mPool; // last, so its destructor waits for the scan first
+};
+
+#endif // FOLDERWATCHER_H
@@ -0,0 +1,154 @@
+#include "collection.h"
+
+#include <QDebug>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QThread>
+#include <QUrl>
+
+#include <algorithm>
+#include <limits>
+
+#include "task.h"
+
+const char* GPX::Collection::mscModuleName = "GPX::Collection:";
+
+GPX::Collection::Collection(QObject* parent) : QObject(parent), mConsumed(0)
+{
+    // parsing is CPU-bound, no use in more threads than cores
+    mPool.setMaxThreadCount(QThread::idealThreadCount());
+
+    mProgress.setInterval(50);
+    connect(&mProgress, &QTimer::timeout, this, [this]{ emit progress(mConsumed, mTotal); });
+}
+
+GPX::Collection::~Collection()
+{
+    cancel();
+    mPool.waitForDone(); // before the loaders are gone
+}
+
+void GPX::Collection::start(const QStringList& fileNames)
+{
+    Q_ASSERT(!isRunning());
+
+    mTrack.clear();
+    mStatistic.clear();
+    mNames.clear();
+    mFileNames.clear();
+    mErrors.clear();
+
+    mRequested = fileNames;
+    mLoaders.clear();
+    mReported.assign(fileNames.size(), 0);
+    mLoaded.assign(fileNames.size(), false);
+    mConsumed = 0;
+    mRemaining.storeRelease(fileNames.size());
+    mCancelled.storeRelease(0);
+    mRunning = true;
+
+    mTotal = 0;
+    for (const QString& fileName: fileNames)
+        mTotal += QFileInfo(QUrl(fileName).path()).size();
+
+    if (fileNames.isEmpty()) {
+        QMetaObject::invokeMethod(this, [this]{ merge(); }, Qt::QueuedConnection);
+        return;
+    }
+
+    // every file gets its own loader, the results are merged in the owner thread
+    for (int i = 0; i < fileNames.size(); ++i)
+        mLoaders.emplace_back(new Loader);
+
+    for (int i = 0; i < fileNames.size(); ++i)
+    {
+        Loader* loader = mLoaders[i].get();
+        qint64* last = &mReported[i];
+
+        QObject::connect(loader, &Loader::progress, loader, [this, last](qint64 current, qint64){
+            mConsumed += current - *last;
+            *last = current;
+        }, Qt::DirectConnection);
+
+        const QString fileName = fileNames[i];
+        char* ok = &mLoaded[i];
+        run(&mPool, [this, loader, fileName, ok]{
+            *ok = !loader->isCancelled() && loader->load(fileName);
+            if (mRemaining.fetchAndSubOrdered(1) == 1)
+                QMetaObject::invokeMethod(this, [this]{ merge(); }, Qt::QueuedConnection);
+        });
+    }
+
+    emit progress(0, mTotal);
+    mProgress.start();
+}
+
+void GPX::Collection::cancel()
+{
+    mCancelled.storeRelease(1);
+    for (const auto& loader: mLoaders)
+        loader->cancel();
+}
+
+bool GPX::Collection::load(const QStringList& fileNames)
+{
+    QEventLoop loop;
+    connect(this, &Collection::finished, &loop, &QEventLoop::quit);
+    start(fileNames);
+    loop.exec();
+
+    return !mFileNames.isEmpty();
+}
+
+/// orders the loaded files and makes one track of them
+void GPX::Collection::merge()
+{
+    mProgress.stop();
+    emit progress(mTotal, mTotal);
+
+    if (isCancelled())
+    {
+        qInfo() << mscModuleName << "cancelled";
+        mLoaders.clear();
+        mRunning = false;
+        emit finished();
+        return;
+    }
+
+    // the files are usually a day each, chaining them by the start time keeps the track chronological
+    std::vector<int> order;
+    for (int i = 0; i < mRequested.size(); ++i)
+    {
+        if (mLoaded[i])
+            order.push_back(i);
+        else
+            mErrors.append(QString("%1: %2").arg(mRequested[i], mLoaders[i]->lastError()));
+    }
+
+    auto start = [this](int i) {
+        const TrackStore& track = mLoaders[i]->track();
+        return track.isEmpty() ? std::numeric_limits<qint64>::max() : track.msecs(0);
+    };
+    std::stable_sort(order.begin(), order.end(), [&start](int a, int b) { return start(a) < start(b); });
+
+    int points = 0;
+    for (int i: order)
+        points += mLoaders[i]->track().size();
+    mTrack.reserve(points);
+
+    for (int i: order)
+    {
+        mTrack.append(mLoaders[i]->track());
+        mStatistic.add(mLoaders[i]->statistic());
+        mFileNames.append(mRequested[i]);
+        if (!mLoaders[i]->name().isEmpty())
+            mNames.append(mLoaders[i]->name());
+    }
+
+    qInfo() << mscModuleName << mFileNames.size() << "of" << mRequested.size() << "file(s) loaded,"
+            << mTrack.size() << "point(s) in" << mTrack.segmentCount() << "segment(s)";
+
+    mLoaders.clear(); // the tracks are copied
+    mRunning = false;
+    emit finished();
+}
@@ -0,0 +1,83 @@
+#ifndef GPX_COLLECTION_H
+#define GPX_COLLECTION_H
+
+#include <QAtomicInt>
+#include <QObject>
+#include <QStringList>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "loader.h"
+#include "statistic.h"
+#include "track.h"
+
+namespace GPX
+{
+
+/// Several GPX files making up one trip, e.g. a file per day.
+/// The files are parsed in parallel and their segments are merged into one track
+/// ordered by the start time of each file; Matcher builds the time index over it
+/// and deals with the overlaps and the gaps between the segments.
+class Collection : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void progress(qint64 consumed, qint64 total);
+    void finished();
+
+public:
+    explicit Collection(QObject* parent = nullptr);
+    ~Collection() override;
+
+    void setThreadCount(int count) { mPool.setMaxThreadCount(count); }
+
+    /// loads in the background, the result is ready on finished()
+    void start(const QStringList& fileNames);
+    void cancel();
+    bool isRunning() const { return mRunning; }
+    bool isCancelled() const { return mCancelled.loadAcquire(); }
+
+    /// synchronous version
+    /// \return false if no file could be loaded, the failures are listed in errors()
+    bool load(const QStringList& fileNames);
+
+    const TrackStore& track() const { return mTrack; }
+    const Statistic& statistic() const { return mStatistic; }
+    QStringList names() const { return mNames; }         // track names of the loaded files
+    QStringList fileNames() const { return mFileNames; } // loaded files in the track order
+    QStringList errors() const { return mErrors; }
+
+private:
+    void merge();
+
+    static const char* mscModuleName;
+
+    QThreadPool mPool;
+
+    // of the current load
+    QStringList mRequested;
+    std::vector<std::unique_ptr<Loader>> mLoaders; // a loader per file
+    std::vector<qint64> mReported; // bytes consumed as reported by each loader
+    std::vector<char> mLoaded;
+    std::atomic<qint64> mConsumed;
+    QAtomicInt mRemaining;
+    QAtomicInt mCancelled;
+    qint64 mTotal = 0;
+    bool mRunning = false;
+    QTimer mProgress; // the loaders report in their threads, the sum is emitted from here
+
+    TrackStore mTrack;
+    Statistic mStatistic;
+    QStringList mNames;
+    QStringList mFileNames;
+    QStringList mErrors;
+};
+
+} // namespace GPX
+
+#endif // GPX_COLLECTION_H
@@ -0,0 +1,321 @@
+#include "decompressor.h"
+
+#include <QDebug>
+
+#include <limits>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef HAVE_BZIP2
+#include <bzlib.h>
+#endif
+
+
+class GPX::Decompressor::Codec
+{
+public:
+    virtual ~Codec() {}
+
+    /// prepares for the next stream
+    virtual bool reset() = 0;
+
+    /// decodes from [*in, inEnd) into \a out, moving *in past the bytes consumed
+    /// \return the bytes written or -1 on error
+    virtual qint64 decode(const char** in, const char* inEnd, char* out, qint64 outSize, bool* streamEnd) = 0;
+
+    QString error() const { return mError; }
+
+    static Codec* create(Format format);
+
+protected:
+    /// the codec libraries count in 32-bit sizes
+    static unsigned clamp(qint64 size) {
+        return static_cast<unsigned>(qMin<qint64>(size, std::numeric_limits<unsigned>::max()));
+    }
+
+    QString mError;
+};
+
+namespace
+{
+
+#ifdef HAVE_ZLIB
+class GzipCodec : public GPX::Decompressor::Codec
+{
+    z_stream mStream;
+    bool mInitialized = false;
+
+public:
+    ~GzipCodec() override { if (mInitialized) inflateEnd(&mStream); }
+
+    bool reset() override {
+        if (mInitialized)
+            return inflateReset(&mStream) == Z_OK;
+
+        mStream = z_stream();
+        // 32 makes zlib detect the gzip header
+        mInitialized = inflateInit2(&mStream, 15 + 32) == Z_OK;
+        if (!mInitialized)
+            mError = mStream.msg ? QString(mStream.msg) : QString("zlib initialization failed");
+        return mInitialized;
+    }
+
+    qint64 decode(const char** in, const char* inEnd, char* out, qint64 outSize, bool* streamEnd) override {
+        mStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(*in));
+        mStream.avail_in = clamp(inEnd - *in);
+        mStream.next_out = reinterpret_cast<Bytef*>(out);
+        mStream.avail_out = clamp(outSize);
+        const uInt availOut = mStream.avail_out;
+
+        const int result = inflate(&mStream, Z_NO_FLUSH);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            mError = mStream.msg ? QString(mStream.msg) : QString("zlib error %1").arg(result);
+            return -1;
+        }
+
+        *streamEnd = result == Z_STREAM_END;
+        *in = reinterpret_cast<const char*>(mStream.next_in);
+        return availOut - mStream.avail_out;
+    }
+};
+#endif
+
+#ifdef HAVE_ZSTD
+class ZstdCodec : public GPX::Decompressor::Codec
+{
+    ZSTD_DStream* mStream = nullptr;
+
+public:
+    ~ZstdCodec() override { ZSTD_freeDStream(mStream); }
+
+    bool reset() override {
+        if (!mStream && !(mStream = ZSTD_createDStream())) {
+            mError = "zstd initialization failed";
+            return false;
+        }
+        const size_t result = ZSTD_initDStream(mStream);
+        if (ZSTD_isError(result)) {
+            mError = ZSTD_getErrorName(result);
+            return false;
+        }
+        return true;
+    }
+
+    qint64 decode(const char** in, const char* inEnd, char* out, qint64 outSize, bool* streamEnd) override {
+        ZSTD_inBuffer input = { *in, static_cast<size_t>(inEnd - *in), 0 };
+        ZSTD_outBuffer output = { out, static_cast<size_t>(outSize), 0 };
+
+        const size_t result = ZSTD_decompressStream(mStream, &output, &input);
+        if (ZSTD_isError(result)) {
+            mError = ZSTD_getErrorName(result);
+            return -1;
+        }
+
+        // 0 is the end of a frame, the next one is read without a reset
+        *streamEnd = result == 0 && input.pos == input.size;
+        *in += input.pos;
+        return static_cast<qint64>(output.pos);
+    }
+};
+#endif
+
+#ifdef HAVE_BZIP2
+class Bzip2Codec : public GPX::Decompressor::Codec
+{
+    bz_stream mStream;
+    bool mInitialized = false;
+
+public:
+    ~Bzip2Codec() override { if (mInitialized) BZ2_bzDecompressEnd(&mStream); }
+
+    bool reset() override {
+        if (mInitialized)
+            BZ2_bzDecompressEnd(&mStream);
+
+        mStream = bz_stream();
+        const int result = BZ2_bzDecompressInit(&mStream, 0, 0);
+        mInitialized = result == BZ_OK;
+        if (!mInitialized)
+            mError = QString("bzip2 error %1").arg(result);
+        return mInitialized;
+    }
+
+    qint64 decode(const char** in, const char* inEnd, char* out, qint64 outSize, bool* streamEnd) override {
+        mStream.next_in = const_cast<char*>(*in);
+        mStream.avail_in = clamp(inEnd - *in);
+        mStream.next_out = out;
+        mStream.avail_out = clamp(outSize);
+        const unsigned availOut = mStream.avail_out;
+
+        const int result = BZ2_bzDecompress(&mStream);
+        if (result != BZ_OK && result != BZ_STREAM_END) {
+            mError = QString("bzip2 error %1").arg(result);
+            return -1;
+        }
+
+        *streamEnd = result == BZ_STREAM_END;
+        *in = mStream.next_in;
+        return availOut - mStream.avail_out;
+    }
+};
+#endif
+
+} // namespace
+
+GPX::Decompressor::Codec* GPX::Decompressor::Codec::create(Format format)
+{
+    switch (format)
+    {
+#ifdef HAVE_ZLIB
+    case Gzip:
+        return new GzipCodec;
+#endif
+#ifdef HAVE_ZSTD
+    case Zstd:
+        return new ZstdCodec;
+#endif
+#ifdef HAVE_BZIP2
+    case Bzip2:
+        return new Bzip2Codec;
+#endif
+    default:
+        return nullptr;
+    }
+}
+
+
+GPX::Decompressor::Format GPX::Decompressor::detect(QIODevice* device)
+{
+    const QByteArray magic = device->peek(4);
+    if (magic.startsWith("\x1F\x8B"))
+        return Gzip;
+    if (magic.startsWith("\x28\xB5\x2F\xFD"))
+        return Zstd;
+    if (magic.startsWith("BZh"))
+        return Bzip2;
+    return Plain;
+}
+
+bool GPX::Decompressor::isSupported(Format format)
+{
+    return format == Plain || std::unique_ptr<Codec>(Codec::create(format)) != nullptr;
+}
+
+QString GPX::Decompressor::name(Format format)
+{
+    switch (format)
+    {
+    case Gzip:
+        return "gzip";
+    case Zstd:
+        return "zstd";
+    case Bzip2:
+        return "bzip2";
+    default:
+        return {};
+    }
+}
+
+GPX::Decompressor::Decompressor(QIODevice* source, Format format, QObject* parent)
+    : QIODevice(parent)
+    , mSource(source)
+    , mFormat(format)
+{
+}
+
+GPX::Decompressor::~Decompressor()
+{
+}
+
+bool GPX::Decompressor::open(OpenMode mode)
+{
+    if (mode & WriteOnly) {
+        setErrorString(tr("Compression is not supported"));
+        return false;
+    }
+
+    mCodec.reset(Codec::create(mFormat));
+    if (!mCodec) {
+        setErrorString(tr("This build does not read %1 compressed files").arg(name(mFormat)));
+        return false;
+    }
+    if (!mCodec->reset()) {
+        setErrorString(mCodec->error());
+        return false;
+    }
+
+    // the input is read in blocks large enough for the codec to run without stalls
+    mInput.resize(256 << 10);
+    mInputBegin = mInputEnd = 0;
+    mFinished = mFailed = false;
+
+    return QIODevice::open(mode);
+}
+
+void GPX::Decompressor::close()
+{
+    QIODevice::close();
+    mCodec.reset();
+    mInput.clear();
+}
+
+bool GPX::Decompressor::atEnd() const
+{
+    return (mFinished || mFailed) && QIODevice::atEnd();
+}
+
+qint64 GPX::Decompressor::readData(char* data, qint64 maxSize)
+{
+    if (mFailed)
+        return -1;
+
+    qint64 written = 0;
+    while (written < maxSize && !mFinished)
+    {
+        if (mInputBegin == mInputEnd)
+        {
+            const qint64 read = mSource->read(mInput.data(), mInput.size());
+            if (read < 0)
+                return fail(mSource->errorString(), written);
+            if (read == 0)
+                return fail(tr("Unexpected end of %1 compressed data").arg(name(mFormat)), written);
+            mInputBegin = 0;
+            mInputEnd = static_cast<int>(read);
+        }
+
+        const char* begin = mInput.constData() + mInputBegin;
+        const char* in = begin;
+        bool streamEnd = false;
+        const qint64 decoded = mCodec->decode(&in, mInput.constData() + mInputEnd, data + written, maxSize - written, &streamEnd);
+        if (decoded < 0)
+            return fail(mCodec->error(), written);
+        if (decoded == 0 && in == begin && !streamEnd)
+            return fail(tr("Corrupted %1 compressed data").arg(name(mFormat)), written);
+
+        mInputBegin = static_cast<int>(in - mInput.constData());
+        written += decoded;
+
+        if (streamEnd)
+        {
+            // another stream may follow, as pigz and pbzip2 write them
+            if (mInputBegin == mInputEnd && mSource->atEnd())
+                mFinished = true;
+            else if (!mCodec->reset())
+                return fail(mCodec->error(), written);
+        }
+    }
+
+    return written > 0 || !mFinished ? written : -1;
+}
+
+qint64 GPX::Decompressor::fail(const QString& text, qint64 written)
+{
+    qWarning().noquote() << "GPX::Decompressor:" << text;
+    mFailed = true;
+    setErrorString(text);
+    return written > 0 ? written : -1;
+}
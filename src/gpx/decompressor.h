@@ -0,0 +1,62 @@
+#ifndef GPX_DECOMPRESSOR_H
+#define GPX_DECOMPRESSOR_H
+
+#include <QByteArray>
+#include <QIODevice>
+
+#include <memory>
+
+namespace GPX
+{
+
+/// Read-only sequential device decompressing another one on the fly, so a compressed
+/// track is parsed without unpacking it first. The format is told by the magic bytes;
+/// each codec is available if its library was found at build time (see compression.pri).
+/// Concatenated streams, as written by pigz or pbzip2, are read one after another.
+class Decompressor : public QIODevice
+{
+    Q_OBJECT
+
+public:
+    enum Format { Plain, Gzip, Zstd, Bzip2 };
+
+    /// peeks at the beginning of \a device, which must be open
+    static Format detect(QIODevice* device);
+    static bool isSupported(Format format);
+    static QString name(Format format);
+
+    Decompressor(QIODevice* source, Format format, QObject* parent = nullptr);
+    ~Decompressor() override;
+
+    bool open(OpenMode mode) override;
+    void close() override;
+
+    bool isSequential() const override { return true; }
+    bool atEnd() const override;
+
+    /// the data could not be decompressed, see errorString()
+    bool hasFailed() const { return mFailed; }
+
+    class Codec;
+
+protected:
+    qint64 readData(char* data, qint64 maxSize) override;
+    qint64 writeData(const char*, qint64) override { return -1; }
+
+private:
+    qint64 fail(const QString& text, qint64 written);
+
+    QIODevice* mSource;
+    Format mFormat;
+    std::unique_ptr<Codec> mCodec;
+
+    QByteArray mInput;
+    int mInputBegin = 0;
+    int mInputEnd = 0;
+    bool mFinished = false;
+    bool mFailed = false;
+};
+
+} // namespace GPX
+
+#endif // GPX_DECOMPRESSOR_H
@@ -0,0 +1,219 @@
+#include "fitreader.h"
+
+#include <QtMath>
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+
+const quint16 RecordMessage = 20;
+const quint16 EventMessage = 21;
+
+const quint8 TimestampField = 253;
+const quint8 LatField = 0;
+const quint8 LonField = 1;
+const quint8 AltitudeField = 2;
+const quint8 EnhancedAltitudeField = 78;
+const quint8 EventField = 0;
+const quint8 EventTypeField = 1;
+
+/// 1989-12-31T00:00:00Z, where the FIT time starts, in Unix seconds
+const qint64 FitEpoch = 631065600;
+
+struct Field
+{
+    quint8 number;
+    quint8 size;
+};
+
+struct Definition
+{
+    bool defined = false;
+    bool bigEndian = false;
+    quint16 message = 0;
+    std::vector<Field> fields;
+    /// of a data message, the developer fields included
+    int size = 0;
+};
+
+quint32 value(const uchar* p, int size, bool bigEndian)
+{
+    quint32 result = 0;
+    for (int i = 0; i < size; ++i)
+        result = result << 8 | p[bigEndian ? i : size - 1 - i];
+    return result;
+}
+
+} // namespace
+
+
+bool GPX::FitReader::canRead(const QByteArray& head) const
+{
+    return head.size() >= 12 && static_cast<uchar>(head[0]) >= 12 && head.mid(8, 4) == ".FIT";
+}
+
+bool GPX::FitReader::read(Input* input, TrackStore* track, Statistic* statistic, QString*, QString* error)
+{
+    auto fail = [error](const QString& text) {
+        *error = text;
+        return false;
+    };
+
+    // the messages only make sense after their definitions, so the file is read as a whole
+    QByteArray content;
+    const char* data = input->map();
+    const bool mapped = data != nullptr;
+    qint64 size = input->size();
+    if (!mapped) {
+        content = input->device()->readAll();
+        data = content.constData();
+        size = content.size();
+    }
+
+    const uchar* const begin = reinterpret_cast<const uchar*>(data);
+    const uchar* const end = begin + size;
+    const uchar* file = begin;
+
+    quint32 timestamp = 0;
+    bool newSegment = false;
+
+    // chained files follow each other, each with its header and CRC
+    while (end - file >= 12)
+    {
+        const int headerSize = file[0];
+        if (headerSize < 12 || end - file < headerSize || std::memcmp(file + 8, ".FIT", 4) != 0) {
+            if (file == begin)
+                return fail(tr("Invalid FIT header"));
+            break;
+        }
+
+        const uchar* p = file + headerSize;
+        const quint32 dataSize = value(file + 4, 4, false);
+        if (dataSize > static_cast<quint64>(end - p))
+            return fail(tr("The FIT file is truncated"));
+        const uchar* const dataEnd = p + dataSize;
+
+        Definition definitions[16];
+        while (p < dataEnd)
+        {
+            const quint8 header = *p++;
+            bool compressed = false;
+            int local;
+
+            if (header & 0x80)
+            {
+                // compressed timestamp header: the offset rolls over every 32 seconds
+                local = (header >> 5) & 0x03;
+                const quint32 offset = header & 0x1F;
+                timestamp = (timestamp & ~0x1Fu) + offset + (offset < (timestamp & 0x1F) ? 0x20 : 0);
+                compressed = true;
+            }
+            else if (header & 0x40)
+            {
+                // definition message
+                Definition& definition = definitions[header & 0x0F];
+                if (dataEnd - p < 5)
+                    return fail(tr("The FIT file is corrupted"));
+
+                definition = Definition();
+                definition.defined = true;
+                definition.bigEndian = p[1] == 1;
+                definition.message = static_cast<quint16>(value(p + 2, 2, definition.bigEndian));
+                const int count = p[4];
+                p += 5;
+
+                if (dataEnd - p < count * 3)
+                    return fail(tr("The FIT file is corrupted"));
+                for (int i = 0; i < count; ++i, p += 3) {
+                    definition.fields.push_back({ p[0], p[1] });
+                    definition.size += p[1];
+                }
+
+                if (header & 0x20)
+                {
+                    // developer fields, only skipped
+                    if (p >= dataEnd || dataEnd - p - 1 < *p * 3)
+                        return fail(tr("The FIT file is corrupted"));
+                    const int developerCount = *p++;
+                    for (int i = 0; i < developerCount; ++i, p += 3)
+                        definition.size += p[1];
+                }
+                continue;
+            }
+            else
+            {
+                local = header & 0x0F;
+            }
+
+            const Definition& definition = definitions[local];
+            if (!definition.defined || dataEnd - p < definition.size)
+                return fail(tr("The FIT file is corrupted"));
+
+            // the value of a field of this message, \a invalid if it is not there
+            auto field = [&definition, p](quint8 number, quint32 invalid) {
+                const uchar* f = p;
+                for (const Field& d: definition.fields) {
+                    if (d.number == number && (d.size == 1 || d.size == 2 || d.size == 4))
+                        return value(f, d.size, definition.bigEndian);
+                    f += d.size;
+                }
+                return invalid;
+            };
+
+            // any message may carry the time the compressed headers count from
+            const quint32 time = field(TimestampField, 0xFFFFFFFF);
+            if (time != 0xFFFFFFFF)
+                timestamp = time;
+
+            if (definition.message == EventMessage)
+            {
+                // the timer stopped by the user or the device ends a segment
+                const quint32 type = field(EventTypeField, 0xFF);
+                if (field(EventField, 0xFF) == 0 && (type == 1 || type == 4 || type == 8 || type == 9))
+                    newSegment = true;
+            }
+            else if (definition.message == RecordMessage)
+            {
+                const quint32 lat = field(LatField, 0x7FFFFFFF);
+                const quint32 lon = field(LonField, 0x7FFFFFFF);
+                if (lat != 0x7FFFFFFF && lon != 0x7FFFFFFF)
+                {
+                    if (!compressed && time == 0xFFFFFFFF)
+                        return fail(tr("No time information in the track"));
+
+                    const double semicircle = 180.0 / 2147483648.0;
+                    const double latitude = static_cast<qint32>(lat) * semicircle;
+                    const double longitude = static_cast<qint32>(lon) * semicircle;
+
+                    // the enhanced one has the range of the high mountains and the flights
+                    double alt = qQNaN();
+                    const quint32 enhancedAltitude = field(EnhancedAltitudeField, 0xFFFFFFFF);
+                    const quint32 altitude = field(AltitudeField, 0xFFFF);
+                    if (enhancedAltitude != 0xFFFFFFFF)
+                        alt = enhancedAltitude / 5.0 - 500;
+                    else if (altitude != 0xFFFF)
+                        alt = altitude / 5.0 - 500;
+
+                    if (newSegment && !track->isEmpty())
+                        track->beginSegment();
+                    newSegment = false;
+
+                    track->append((FitEpoch + timestamp) * 1000, latitude, longitude, alt);
+                    statistic->add(latitude, longitude);
+                }
+            }
+
+            p += definition.size;
+        }
+
+        // the CRC is not checked, a damaged file still gives its points
+        file = end - dataEnd > 2 ? dataEnd + 2 : end;
+
+        if (!(mapped ? input->progress(qMin<qint64>(file - begin, size)) : input->progress()))
+            return fail(tr("Cancelled"));
+    }
+
+    return true;
+}
@@ -0,0 +1,26 @@
+#ifndef GPX_FITREADER_H
+#define GPX_FITREADER_H
+
+#include <QCoreApplication>
+
+#include "trackreader.h"
+
+namespace GPX
+{
+
+/// Garmin FIT activity files: the record messages with a position make the points and
+/// a timer stop event ends a segment. Chained FIT files are read one after another.
+class FitReader : public Reader
+{
+    Q_DECLARE_TR_FUNCTIONS(GPX::FitReader)
+
+public:
+    QString format() const override { return "FIT"; }
+    QStringList nameFilters() const override { return { "*.fit" }; }
+    bool canRead(const QByteArray& head) const override;
+    bool read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error) override;
+};
+
+} // namespace GPX
+
+#endif // GPX_FITREADER_H
@@ -0,0 +1,132 @@
+#include "geojsonreader.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QtMath>
+
+#include "parser.h"
+
+namespace
+{
+
+/// an ISO 8601 string or a number of seconds, of milliseconds if it is that large
+bool parseTime(const QJsonValue& value, qint64* msecs)
+{
+    if (value.isString()) {
+        const QByteArray text = value.toString().trimmed().toLatin1();
+        return GPX::Parser::parseTime(text.constData(), text.constData() + text.size(), msecs);
+    }
+    if (value.isDouble()) {
+        const double number = value.toDouble();
+        *msecs = qRound64(number > 1e11 ? number : number * 1000);
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+
+bool GPX::GeoJsonReader::canRead(const QByteArray& head) const
+{
+    int i = head.startsWith("\xEF\xBB\xBF") ? 3 : 0;
+    while (i < head.size() && QChar::isSpace(static_cast<uchar>(head[i])))
+        ++i;
+    return i < head.size() && head[i] == '{' && head.contains("\"type\"");
+}
+
+bool GPX::GeoJsonReader::read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error)
+{
+    auto fail = [error](const QString& text) {
+        *error = text;
+        return false;
+    };
+
+    // JSON has no streaming reader in Qt, the document is parsed as a whole
+    QByteArray content;
+    if (const char* data = input->map())
+        content = QByteArray::fromRawData(data, static_cast<int>(input->size()));
+    else
+        content = input->device()->readAll();
+
+    QJsonParseError parseError;
+    const QJsonDocument document = QJsonDocument::fromJson(content, &parseError);
+    if (document.isNull())
+        return fail(tr("Invalid GeoJSON: %1").arg(parseError.errorString()));
+    if (!input->progress(input->size()))
+        return fail(tr("Cancelled"));
+
+    const QJsonObject root = document.object();
+    const QString rootType = root["type"].toString();
+    QJsonArray features;
+    if (rootType == "FeatureCollection")
+        features = root["features"].toArray();
+    else if (rootType == "Feature")
+        features.append(root);
+    else
+        features.append(QJsonObject{ { "type", "Feature" }, { "geometry", root } });
+
+    // the Point features one after another make a segment
+    bool inPoints = false;
+
+    for (const QJsonValue& value: features)
+    {
+        const QJsonObject feature = value.toObject();
+        const QJsonObject properties = feature["properties"].toObject();
+        const QJsonObject geometry = feature["geometry"].toObject();
+        const QString type = geometry["type"].toString();
+
+        QJsonArray lines;
+        QJsonArray times;
+        if (type == "LineString") {
+            lines.append(geometry["coordinates"]);
+            times.append(properties.contains("coordTimes") ? properties["coordTimes"] : properties["times"]);
+        } else if (type == "MultiLineString") {
+            lines = geometry["coordinates"].toArray();
+            times = (properties.contains("coordTimes") ? properties["coordTimes"] : properties["times"]).toArray();
+        } else if (type == "Point") {
+            lines.append(QJsonArray{ geometry["coordinates"] });
+            times.append(QJsonArray{ properties.contains("time") ? properties["time"] : properties["timestamp"] });
+        } else {
+            inPoints = false;
+            continue;
+        }
+
+        if (name->isEmpty())
+            *name = properties["name"].toString();
+
+        for (int l = 0; l < lines.size(); ++l)
+        {
+            const QJsonArray line = lines[l].toArray();
+            const QJsonArray lineTimes = times[l].toArray();
+
+            if (!line.isEmpty() && !track->isEmpty() && !(type == "Point" && inPoints))
+                track->beginSegment();
+            inPoints = type == "Point";
+
+            for (int i = 0; i < line.size(); ++i)
+            {
+                // [lon, lat, alt, time], the last two are optional
+                const QJsonArray position = line[i].toArray();
+                if (position.size() < 2)
+                    continue;
+
+                qint64 msecs;
+                if (!parseTime(i < lineTimes.size() ? lineTimes[i] : position[3], &msecs))
+                    return fail(tr("No time information in the track"));
+
+                const double lat = position[1].toDouble();
+                const double lon = position[0].toDouble();
+                const double alt = position.size() > 2 && position[2].isDouble() ? position[2].toDouble() : qQNaN();
+                track->append(msecs, lat, lon, alt);
+                statistic->add(lat, lon);
+            }
+        }
+
+        if (input->isCancelled())
+            return fail(tr("Cancelled"));
+    }
+
+    return true;
+}
@@ -0,0 +1,27 @@
+#ifndef GPX_GEOJSONREADER_H
+#define GPX_GEOJSONREADER_H
+
+#include <QCoreApplication>
+
+#include "trackreader.h"
+
+namespace GPX
+{
+
+/// GeoJSON LineString and MultiLineString features with the times in the "coordTimes"
+/// property (as togeojson writes them) or as the fourth coordinate, and Point features
+/// with a "time" property. The document is read as a whole.
+class GeoJsonReader : public Reader
+{
+    Q_DECLARE_TR_FUNCTIONS(GPX::GeoJsonReader)
+
+public:
+    QString format() const override { return "GeoJSON"; }
+    QStringList nameFilters() const override { return { "*.geojson", "*.json" }; }
+    bool canRead(const QByteArray& head) const override;
+    bool read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error) override;
+};
+
+} // namespace GPX
+
+#endif // GPX_GEOJSONREADER_H
@@ -0,0 +1,323 @@
+#include "gpxreader.h"
+
+#include <QAtomicInteger>
+#include <QDebug>
+#include <QThread>
+#include <QThreadPool>
+#include <QXmlStreamReader>
+
+#include <vector>
+
+#include "task.h"
+
+const char* GPX::GpxReader::mscModuleName = "GPX::GpxReader:";
+
+
+class XmlElement
+{
+    QXmlStreamReader* mXml;
+
+public:
+    explicit XmlElement(QXmlStreamReader* xml) : mXml(xml) {
+//        qDebug() << mXml->name() << mXml->lineNumber() << mXml->tokenString();
+    }
+
+    ~XmlElement() { if (mXml) mXml->skipCurrentElement(); }
+
+    bool operator ==(const QString& name) {
+        if (mXml && mXml->name() == name) {
+            // matched, don't skip
+            mXml = nullptr;
+            return true;
+        }
+        return false;
+    }
+};
+
+bool GPX::GpxReader::canRead(const QByteArray& head) const
+{
+    return xmlRoot(head) == "gpx";
+}
+
+bool GPX::GpxReader::read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error)
+{
+    mInput = input;
+    mTrack = track;
+    mStatistic = statistic;
+    mName = name;
+
+    Parser::Result result = Parser::Unsupported;
+    if (input->isCompressed())
+        result = parseStream();
+    else if (const char* begin = input->map())
+        result = parse(begin, begin + input->size());
+
+    switch (result)
+    {
+    case Parser::Parsed:
+        return true;
+    case Parser::NoTimestamp:
+        *error = tr("No time information in the track");
+        return false;
+    case Parser::Stopped:
+        *error = tr("Cancelled");
+        return false;
+    case Parser::Unsupported:
+        break;
+    }
+
+    if (input->hasFailed())
+        return false;
+
+    qInfo() << mscModuleName << "reading with the XML reader";
+    clear();
+    if (!input->open()) {
+        *error = input->errorString();
+        return false;
+    }
+    return readXml(error);
+}
+
+bool GPX::GpxReader::readXml(QString* error)
+{
+    auto fail = [error](const QString& text) {
+        *error = text;
+        return false;
+    };
+
+    // the reader pulls the content in small chunks and detects the encoding itself,
+    // so the document is never held in memory as a whole
+    QXmlStreamReader xml(mInput->device());
+    qint64 reported = 0;
+
+    while (xml.readNextStartElement())
+    {
+        XmlElement gpx(&xml);
+        if (gpx == "gpx")
+        {
+            while (xml.readNextStartElement())
+            {
+                XmlElement trk(&xml);
+                if (trk == "trk")
+                {
+                    while (xml.readNextStartElement())
+                    {
+                        XmlElement trkseg(&xml);
+                        if (trkseg == "name")
+                        {
+                            *mName = xml.readElementText(QXmlStreamReader::SkipChildElements);
+                        }
+                        else if (trkseg == "trkseg")
+                        {
+                            mTrack->beginSegment();
+                            while (xml.readNextStartElement())
+                            {
+                                XmlElement trkpt(&xml);
+                                if (trkpt == "trkpt")
+                                {
+                                    QDateTime timestamp;
+                                    double lat = xml.attributes().value("lat").toDouble();
+                                    double lon = xml.attributes().value("lon").toDouble();
+                                    double alt = qQNaN();
+
+                                    while (xml.readNextStartElement())
+                                    {
+                                        XmlElement ele(&xml);
+                                        if (ele == "ele")
+                                            alt = xml.readElementText().toDouble();
+                                        else if (ele == "time")
+                                            timestamp = stringToDateTime(xml.readElementText());
+                                    }
+
+                                    if (timestamp.isNull())
+                                        return fail(tr("No time information in the track"));
+
+                                    mTrack->append(timestamp.toMSecsSinceEpoch(), lat, lon, alt);
+                                    mStatistic->add(lat, lon);
+
+                                    // the device position moves in chunks, so this is rare enough
+                                    if (mInput->pos() != reported) {
+                                        if (!mInput->progress(reported = mInput->pos()))
+                                            return fail(tr("Cancelled"));
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+void GPX::GpxReader::clear()
+{
+    mTrack->clear();
+    mName->clear();
+    mStatistic->clear();
+}
+
+GPX::Parser::Result GPX::GpxReader::parse(const char* begin, const char* end)
+{
+    const qint64 total = end - begin;
+    if (mInput->chunkSize() > 0 && total / mInput->chunkSize() > 1 && QThread::idealThreadCount() > 1)
+    {
+        const Parser::Result result = parseChunks(begin, end);
+        if (result != Parser::Unsupported)
+            return result;
+
+        qInfo() << mscModuleName << "the document does not split into chunks, parsing in one go";
+        clear();
+        mInput->progress(0);
+    }
+
+    Parser parser(mTrack, mStatistic, mName);
+    parser.setProgress([this](qint64 consumed) { return mInput->progress(consumed); });
+    return parser.parse(begin, end);
+}
+
+GPX::Parser::Result GPX::GpxReader::parseStream()
+{
+    static const int BlockSize = 1 << 20;
+    // a document without track points is not worth holding in memory as a whole
+    static const int MaxPending = 64 << 20;
+
+    QIODevice* stream = mInput->device();
+    Parser parser(mTrack, mStatistic, mName);
+
+    // the parser goes on from where it stopped, so the blocks are parsed up to the last
+    // track point and the rest is kept for the next round
+    QByteArray buffer;
+    for (;;)
+    {
+        const int pending = buffer.size();
+        buffer.resize(pending + BlockSize);
+        const qint64 read = stream->read(buffer.data() + pending, BlockSize);
+        buffer.resize(pending + static_cast<int>(qMax<qint64>(read, 0)));
+
+        const char* begin = buffer.constData();
+        const char* end = begin + buffer.size();
+
+        // the end of the stream or its failure, even before the first byte;
+        // Loader tells the failure from the device
+        if (read <= 0)
+            return parser.parse(begin, end, true);
+
+        const char* cut = Parser::findLastPoint(begin, end);
+        if (cut && cut != begin) {
+            const Parser::Result result = parser.parse(begin, cut, false);
+            if (result != Parser::Parsed)
+                return result;
+            buffer.remove(0, static_cast<int>(cut - begin));
+        }
+        else if (buffer.size() > MaxPending)
+            return Parser::Unsupported;
+
+        if (!mInput->progress())
+            return Parser::Stopped;
+    }
+}
+
+GPX::Parser::Result GPX::GpxReader::parseChunks(const char* begin, const char* end)
+{
+    const qint64 total = end - begin;
+    const int count = static_cast<int>(qMin<qint64>(QThread::idealThreadCount(), total / mInput->chunkSize()));
+
+    // "<trkpt" can only be a tag or inside a comment, CDATA section or processing instruction,
+    // and then the chunk before it fails on the markup left open
+    std::vector<const char*> bounds{ begin };
+    for (int i = 1; i < count; ++i) {
+        const char* point = Parser::findPoint(begin + total * i / count, end);
+        if (!point)
+            break;
+        if (point > bounds.back())
+            bounds.push_back(point);
+    }
+    bounds.push_back(end);
+
+    struct Chunk
+    {
+        TrackStore track;
+        Statistic statistic;
+        QString name;
+        Parser::Result result = Parser::Parsed;
+        bool inSegment = false;
+        qint64 reported = 0;
+    };
+
+    const int chunkCount = static_cast<int>(bounds.size()) - 1;
+    std::vector<Chunk> chunks(chunkCount);
+    QAtomicInteger<qint64> consumed(0);
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(chunkCount);
+
+    for (int i = 0; i < chunkCount; ++i)
+    {
+        run(&pool, [this, i, chunkCount, &chunks, &bounds, &consumed]{
+            Chunk& chunk = chunks[i];
+            Parser parser(&chunk.track, &chunk.statistic, &chunk.name);
+            if (i > 0)
+                parser.resumeInSegment();
+            parser.setProgress([this, &chunk, &consumed](qint64 done) {
+                if (mInput->isCancelled())
+                    return false;
+                consumed.fetchAndAddRelaxed(done - chunk.reported);
+                chunk.reported = done;
+                return true;
+            });
+
+            const bool last = i + 1 == chunkCount;
+            chunk.result = parser.parse(bounds[i], bounds[i + 1], last);
+            chunk.inSegment = parser.isInSegment();
+        });
+    }
+
+    // the progress is reported from the loading thread only
+    bool stopped = false;
+    while (!pool.waitForDone(50))
+        if (!stopped && !mInput->progress(consumed.loadAcquire()))
+            stopped = true; // the chunks see it themselves
+
+    qInfo() << mscModuleName << "parsed in" << chunkCount << "chunk(s)";
+
+    // the first error in the document order is what parsing in one go would meet
+    for (int i = 0; i < chunkCount; ++i) {
+        if (chunks[i].result != Parser::Parsed)
+            return chunks[i].result;
+        if (i + 1 < chunkCount && !chunks[i].inSegment)
+            return Parser::Unsupported;
+    }
+
+    int points = 0;
+    for (const Chunk& chunk: chunks)
+        points += chunk.track.size();
+    mTrack->reserve(points);
+
+    for (int i = 0; i < chunkCount; ++i)
+    {
+        Chunk& chunk = chunks[i];
+        if (i == 0)
+            mTrack->append(chunk.track);
+        else
+            mTrack->appendContinued(chunk.track);
+        chunk.track.clear();
+
+        mStatistic->add(chunk.statistic);
+        if (!chunk.name.isEmpty())
+            *mName = chunk.name;
+    }
+
+    return Parser::Parsed;
+}
+
+QDateTime GPX::GpxReader::stringToDateTime(const QString& s)
+{
+    const QByteArray latin1 = s.toLatin1();
+    qint64 msecs = 0;
+    if (!Parser::parseTime(latin1.constData(), latin1.constData() + latin1.size(), &msecs))
+        return {};
+    return QDateTime::fromMSecsSinceEpoch(msecs, Qt::UTC); // only the epoch time is stored
+}
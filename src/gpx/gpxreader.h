@@ -0,0 +1,45 @@
+#ifndef GPX_GPXREADER_H
+#define GPX_GPXREADER_H
+
+#include <QCoreApplication>
+#include <QDateTime>
+
+#include "parser.h"
+#include "trackreader.h"
+
+namespace GPX
+{
+
+/// GPX 1.0 and 1.1. The usual layout is read by Parser: straight from the mapped file,
+/// in parallel chunks if it is large, or block by block from the decompressed stream;
+/// anything Parser does not handle is read again by QXmlStreamReader.
+class GpxReader : public Reader
+{
+    Q_DECLARE_TR_FUNCTIONS(GPX::GpxReader)
+
+public:
+    QString format() const override { return "GPX"; }
+    QStringList nameFilters() const override { return { "*.gpx" }; }
+    bool canRead(const QByteArray& head) const override;
+    bool read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error) override;
+
+    static QDateTime stringToDateTime(const QString& s);
+
+private:
+    Parser::Result parse(const char* begin, const char* end);
+    Parser::Result parseChunks(const char* begin, const char* end);
+    Parser::Result parseStream();
+    bool readXml(QString* error);
+    void clear();
+
+    static const char* mscModuleName;
+
+    Input* mInput = nullptr;
+    TrackStore* mTrack = nullptr;
+    Statistic* mStatistic = nullptr;
+    QString* mName = nullptr;
+};
+
+} // namespace GPX
+
+#endif // GPX_GPXREADER_H
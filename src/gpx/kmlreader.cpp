@@ -0,0 +1,125 @@
+#include "kmlreader.h"
+
+#include <QVector>
+#include <QXmlStreamReader>
+#include <QtMath>
+
+#include "parser.h"
+
+namespace
+{
+
+struct Coord
+{
+    double lat;
+    double lon;
+    double alt;
+};
+
+/// "lon lat alt", the altitude may be missing
+bool parseCoord(const QString& text, Coord* coord)
+{
+    const QStringList values = text.simplified().split(' ');
+    bool ok[2];
+    coord->lon = values.value(0).toDouble(&ok[0]);
+    coord->lat = values.value(1).toDouble(&ok[1]);
+    bool hasAlt = false;
+    coord->alt = values.value(2).toDouble(&hasAlt);
+    if (!hasAlt)
+        coord->alt = qQNaN();
+    return ok[0] && ok[1];
+}
+
+} // namespace
+
+
+bool GPX::KmlReader::canRead(const QByteArray& head) const
+{
+    return xmlRoot(head) == "kml";
+}
+
+bool GPX::KmlReader::read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error)
+{
+    auto fail = [error](const QString& text) {
+        *error = text;
+        return false;
+    };
+
+    QXmlStreamReader xml(input->device());
+    QString placemark;
+    // the names of the open elements, to tell whose <name> it is
+    QVector<QString> path;
+    // the <when> elements may all come before the <gx:coord> ones
+    QVector<qint64> whens;
+    QVector<Coord> coords;
+    qint64 reported = 0;
+
+    while (!xml.atEnd())
+    {
+        const QXmlStreamReader::TokenType token = xml.readNext();
+        if (token == QXmlStreamReader::StartElement)
+        {
+            const QString element = xml.name().toString();
+            if (element == "name" && !path.isEmpty())
+            {
+                const QString text = xml.readElementText(QXmlStreamReader::SkipChildElements).trimmed();
+                if (path.last() == "Placemark")
+                    placemark = text;
+                else if (path.last() == "Document" && name->isEmpty())
+                    *name = text;
+                continue;
+            }
+            if (element == "when" && !path.isEmpty() && path.last() == "Track")
+            {
+                const QByteArray text = xml.readElementText().trimmed().toLatin1();
+                qint64 msecs;
+                if (!Parser::parseTime(text.constData(), text.constData() + text.size(), &msecs))
+                    return fail(tr("No time information in the track"));
+                whens.append(msecs);
+                continue;
+            }
+            if (element == "coord" && !path.isEmpty() && path.last() == "Track")
+            {
+                Coord coord;
+                if (parseCoord(xml.readElementText(), &coord))
+                    coords.append(coord);
+                continue;
+            }
+
+            if (element == "Placemark")
+                placemark.clear();
+            else if (element == "Track") {
+                whens.clear();
+                coords.clear();
+            }
+            path.append(element);
+        }
+        else if (token == QXmlStreamReader::EndElement)
+        {
+            if (path.last() == "Track")
+            {
+                if (whens.size() != coords.size())
+                    return fail(tr("The gx:Track has %1 times for %2 positions").arg(whens.size()).arg(coords.size()));
+
+                // each track is a segment, those of a gx:MultiTrack too
+                if (!whens.isEmpty() && !track->isEmpty())
+                    track->beginSegment();
+                for (int i = 0; i < whens.size(); ++i) {
+                    track->append(whens[i], coords[i].lat, coords[i].lon, coords[i].alt);
+                    statistic->add(coords[i].lat, coords[i].lon);
+                }
+
+                if (!whens.isEmpty() && !placemark.isEmpty())
+                    *name = placemark;
+            }
+            path.removeLast();
+
+            if (input->pos() != reported && !input->progress(reported = input->pos()))
+                return fail(tr("Cancelled"));
+        }
+    }
+
+    if (xml.hasError())
+        return fail(xml.errorString());
+    return true;
+}
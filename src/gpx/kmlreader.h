@@ -0,0 +1,26 @@
+#ifndef GPX_KMLREADER_H
+#define GPX_KMLREADER_H
+
+#include <QCoreApplication>
+
+#include "trackreader.h"
+
+namespace GPX
+{
+
+/// KML with gx:Track elements, each one makes a segment of its when/gx:coord pairs;
+/// the track name is the one of the placemark.
+class KmlReader : public Reader
+{
+    Q_DECLARE_TR_FUNCTIONS(GPX::KmlReader)
+
+public:
+    QString format() const override { return "KML"; }
+    QStringList nameFilters() const override { return { "*.kml" }; }
+    bool canRead(const QByteArray& head) const override;
+    bool read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error) override;
+};
+
+} // namespace GPX
+
+#endif // GPX_KMLREADER_H
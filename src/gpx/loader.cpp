@@ -10,12 +10,14 @@
 #include <QGeoPath>
 #include <QUrl>
 #include <QFile>
-#include <QFileInfo>
-#include <QXmlStreamReader>
-#include <QTextCodec>
 #include <QTimeZone>
 #include <QPointF>
 
+#include <memory>
+
+#include "decompressor.h"
+#include "trackreader.h"
+
 //#undef qDebug
 //#define qDebug QT_NO_QDEBUG_MACRO
 
@@ -28,125 +30,85 @@ inline double linear_interpolation(double v1, double v2, double passed) {
     return v1 + (v2 - v1) * passed;
 }
 
-QGeoCoordinate GPX::interpolated(const QGeoPositionInfo& before, const QGeoPositionInfo& after, const QDateTime time)
+QGeoCoordinate GPX::interpolated(const TrackStore& track, int before, int after, qint64 msecs)
 {
-    double total = before.timestamp().secsTo(after.timestamp());
-    double passed = before.timestamp().secsTo(time);
+    double total = track.msecs(after) - track.msecs(before);
+    double passed = msecs - track.msecs(before);
     passed /= total; // [0; 1)
 
-    double lat = linear_interpolation(before.coordinate().latitude(), after.coordinate().latitude(), passed);
-    double lon = linear_interpolation(before.coordinate().longitude(), after.coordinate().longitude(), passed);
-    double alt = linear_interpolation(before.coordinate().altitude(), after.coordinate().altitude(), passed);
+    double lat = linear_interpolation(track.latitude(before), track.latitude(after), passed);
+    double lon = linear_interpolation(track.longitude(before), track.longitude(after), passed);
+    double alt = linear_interpolation(track.altitude(before), track.altitude(after), passed);
 
     return QGeoCoordinate(lat, lon, alt);
 }
 
-class XmlElement
-{
-    QXmlStreamReader* mXml;
-
-public:
-    explicit XmlElement(QXmlStreamReader* xml) : mXml(xml) {
-//        qDebug() << mXml->name() << mXml->lineNumber() << mXml->tokenString();
-    }
-
-    ~XmlElement() { if (mXml) mXml->skipCurrentElement(); }
-
-    bool operator ==(const QString& name) {
-        if (mXml && mXml->name() == name) {
-            // matched, don't skip
-            mXml = nullptr;
-            return true;
-        }
-        return false;
-    }
-};
-
 bool GPX::Loader::load(const QString& url)
 {
     qInfo() << mscModuleName << "loading" << url << "...";
 
     const QString fileName = QUrl(url).path();
 
-    const QString suffix = QFileInfo(fileName).suffix();
-    if (suffix != "gpx")
-        return warn(tr("No '*.%1' files support").arg(suffix));
-
     QFile file(fileName);
 
     if (!file.open(QIODevice::ReadOnly))
         return warn(tr("Unable to open '%1': %2").arg(fileName, file.errorString()));
 
-    QTextStream stream(&file);
-    stream.setCodec(QTextCodec::codecForName("UTF-8"));
-    QString data = stream.readAll();
+    // both the compression and the format are told by the content, whatever the name is
+    const Decompressor::Format compression = Decompressor::detect(&file);
+    if (!Decompressor::isSupported(compression))
+        return warn(tr("Unable to load '%1': %2 compression is not supported").arg(fileName, Decompressor::name(compression)));
+
+    const qint64 total = file.size();
+    Input input(&file, compression,
+                [this, total](qint64 consumed) {
+                    emit progress(consumed, total);
+                    return !isCancelled();
+                },
+                [this]{ return isCancelled(); });
+    input.setChunkSize(mChunkSize);
+
+    if (!input.open())
+        return warn(tr("Unable to load '%1': %2").arg(fileName, input.errorString()));
+
+    std::unique_ptr<Reader> reader = Reader::create(input.head(), fileName);
+    if (!reader)
+        return warn(tr("Unable to load '%1': unknown track format").arg(fileName));
+
+    qInfo().noquote() << mscModuleName << reader->format()
+                      << (input.isCompressed() ? Decompressor::name(compression) : QString());
 
     mTrack.clear();
     mName.clear();
     mStatistic.clear();
+    emit progress(0, total);
 
-    QXmlStreamReader xml(data);
-
-    while (xml.readNextStartElement())
-    {
-        XmlElement gpx(&xml);
-        if (gpx == "gpx")
-        {
-            while (xml.readNextStartElement())
-            {
-                XmlElement trk(&xml);
-                if (trk == "trk")
-                {
-                    while (xml.readNextStartElement())
-                    {
-                        XmlElement trkseg(&xml);
-                        if (trkseg == "name")
-                        {
-                            mName = xml.readElementText(QXmlStreamReader::SkipChildElements);
-                        }
-                        else if (trkseg == "trkseg")
-                        {
-                            GPX::Segment segment;
-                            while (xml.readNextStartElement())
-                            {
-                                XmlElement trkpt(&xml);
-                                if (trkpt == "trkpt")
-                                {
-                                    QGeoCoordinate coord;
-                                    QDateTime timestamp;
-                                    coord.setLatitude(xml.attributes().value("lat").toDouble());
-                                    coord.setLongitude(xml.attributes().value("lon").toDouble());
-
-                                    while (xml.readNextStartElement())
-                                    {
-                                        XmlElement ele(&xml);
-                                        if (ele == "ele")
-                                            coord.setAltitude(xml.readElementText().toDouble());
-                                        else if (ele == "time")
-                                            timestamp = stringToDateTime(xml.readElementText());
-                                    }
-
-                                    if (timestamp.isNull())
-                                        return warn(tr("No time information in the track"));
-
-                                    QGeoPositionInfo point(coord, timestamp);
-                                    segment.append(point);
-                                    mStatistic.add(coord.latitude(), coord.longitude());
-                                }
-                            }
-
-                            mTrack.append(segment);
-                        }
-                    }
-                }
-            }
-        }
-    }
+    QString error;
+    const bool ok = reader->read(&input, &mTrack, &mStatistic, &mName, &error);
+
+    // a reader fails on the broken data as well, but that is not the cause
+    if (input.hasFailed())
+        return warn(tr("Unable to load '%1': %2").arg(fileName, input.device()->errorString()));
+    if (!ok)
+        return warn(error);
+
+    return loaded(total);
+}
+
+QStringList GPX::Loader::nameFilters()
+{
+    return Reader::allNameFilters();
+}
+
+bool GPX::Loader::loaded(qint64 total)
+{
+    mTrack.squeeze();
+    emit progress(total, total);
 
     qInfo() << mscModuleName << mStatistic.total() << "point(s) loaded";
-    if (!mTrack.isEmpty() && !mTrack.first().isEmpty() && !mTrack.last().isEmpty()) {
-        qInfo() << mscModuleName << "start:" << mTrack.first().first().timestamp();
-        qInfo() << mscModuleName << "end:  " << mTrack.last().last().timestamp();
+    if (!mTrack.isEmpty()) {
+        qInfo() << mscModuleName << "start:" << mTrack.timestamp(0);
+        qInfo() << mscModuleName << "end:  " << mTrack.timestamp(mTrack.size() - 1);
     }
 
     return true;
@@ -158,23 +120,3 @@ bool GPX::Loader::warn(const QString& text)
     qWarning().noquote() << mscModuleName << mLastError;
     return false;
 }
-
-QDateTime GPX::Loader::stringToDateTime(const QString& s)
-{
-    static const int isoStrLen = QString("2021-07-01T06:58:09").length();
-
-    if (s.length() == isoStrLen + 1 && (s[isoStrLen] == 'Z' || s[isoStrLen] == 'z'))
-    {
-        // ISO 8601 with Z suffix
-        QDateTime dt = QDateTime::fromString(s.left(isoStrLen), Qt::ISODate);
-        dt.setTimeSpec(Qt::UTC);
-        return dt.toLocalTime();
-    }
-
-    if (s.length() == isoStrLen)
-    {
-        return QDateTime::fromString(s, Qt::ISODate);
-    }
-
-    return {};
-}
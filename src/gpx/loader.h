@@ -1,8 +1,10 @@
 #ifndef GPX_LOADER_H
 #define GPX_LOADER_H
 
-#include <QCoreApplication>
+#include <QAtomicInt>
+#include <QObject>
 #include <QPointF>
+#include <QStringList>
 
 #include "statistic.h"
 #include "track.h"
@@ -12,32 +14,51 @@ class QGeoPath;
 namespace GPX
 {
 
-QGeoCoordinate interpolated(const QGeoPositionInfo& before, const QGeoPositionInfo& after, const QDateTime time);
+QGeoCoordinate interpolated(const TrackStore& track, int before, int after, qint64 msecs);
 
-class Loader
+/// Loads a track file of any format Reader knows, compressed or not. The content is parsed
+/// straight from the mapped file or from the device, so the memory peak is about the size
+/// of the resulting track; progress is reported in bytes of the file consumed.
+class Loader : public QObject
 {
-    Q_DECLARE_TR_FUNCTIONS(Loader)
+    Q_OBJECT
+
+signals:
+    void progress(qint64 consumed, qint64 total);
 
 public:
     bool load(const QString& url);
+    /// the plain and compressed track file names, e.g. for a file dialog
+    static QStringList nameFilters();
+
     QString lastError() const { return mLastError; }
 
-    Track track() const { return mTrack; }
+    /// files of at least twice \a bytes are split into chunks of \a bytes or more, parsed
+    /// in parallel up to a chunk per core; 0 parses every file in one go
+    void setChunkSize(qint64 bytes) { mChunkSize = bytes; }
+
+    /// makes load() fail soon, may be called from any thread
+    void cancel() { mCancelled.storeRelease(1); }
+    bool isCancelled() const { return mCancelled.loadAcquire(); }
+
+    const TrackStore& track() const { return mTrack; }
     QString name() const { return mName; }
     const Statistic& statistic() const { return mStatistic; }
 
 private:
     bool warn(const QString& text);
-
-    static QDateTime stringToDateTime(const QString& s);
+    bool loaded(qint64 total);
 
     static const char* mscModuleName;
 
-    Track mTrack;
+    TrackStore mTrack;
     QString mName;
     Statistic mStatistic;
 
+    qint64 mChunkSize = 16 << 20;
+
     QString mLastError;
+    QAtomicInt mCancelled;
 };
 
 } // namespace GPX
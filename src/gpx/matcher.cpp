@@ -0,0 +1,154 @@
+#include "matcher.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include <QDebug>
+
+#include "loader.h"
+
+const char* GPX::Matcher::mscModuleName = "GPX::Matcher:";
+
+void GPX::Matcher::setTrack(const TrackStore& track)
+{
+    clear();
+    mTrack = track;
+
+    const int size = track.size();
+    const qint64* time = track.times().constData();
+    auto earlier = [time](int a, int b) { return time[a] < time[b]; };
+
+    // points ordered by time within each segment
+    QVector<int> order(size);
+    std::iota(order.begin(), order.end(), 0);
+    bool jumps = false;
+    for (int segment = 0; segment < track.segmentCount(); ++segment)
+    {
+        const int begin = track.segmentBegin(segment);
+        const int end = track.segmentEnd(segment);
+        if (!std::is_sorted(time + begin, time + end)) {
+            std::stable_sort(order.begin() + begin, order.begin() + end, earlier);
+            jumps = true;
+        }
+    }
+
+    if (jumps)
+        qWarning() << mscModuleName << "track timestamps are not monotonic";
+
+    // non-empty segments ordered by their first point
+    QVector<int> segments;
+    for (int segment = 0; segment < track.segmentCount(); ++segment)
+        if (track.segmentBegin(segment) < track.segmentEnd(segment))
+            segments.append(segment);
+
+    std::stable_sort(segments.begin(), segments.end(), [&track, &order, &earlier](int a, int b) {
+        return earlier(order[track.segmentBegin(a)], order[track.segmentBegin(b)]);
+    });
+
+    mTime.reserve(size);
+    mPoint.reserve(size);
+    int overlapping = 0;
+    for (int segment: qAsConst(segments))
+    {
+        // the segments start in order, so only the head of a segment may overlap the ones before
+        bool started = false;
+        bool overlaps = false;
+        for (int k = track.segmentBegin(segment); k < track.segmentEnd(segment); ++k)
+        {
+            const int i = order[k];
+            if (qIsNaN(track.latitude(i)) || qIsNaN(track.longitude(i)))
+                continue;
+            if (!mTime.isEmpty() && mTime.last() >= time[i]) {
+                overlaps |= !started && mTime.last() > time[i];
+                continue; // nothing to interpolate between the points of the same time
+            }
+
+            if (!started) {
+                mSpans.append(mTime.size());
+                started = true;
+            }
+
+            mTime.append(time[i]);
+            mPoint.append(i);
+        }
+
+        overlapping += overlaps;
+    }
+
+    if (overlapping)
+        qInfo() << mscModuleName << overlapping << "segment(s) overlap the earlier ones, the overlaps are skipped";
+    if (mTime.size() != size)
+        qInfo() << mscModuleName << size - mTime.size() << "point(s) excluded from the time index";
+}
+
+void GPX::Matcher::clear()
+{
+    mTrack.clear();
+    mTime.clear();
+    mPoint.clear();
+    mSpans.clear();
+}
+
+/// \a upper is the index of the first time index entry greater than the time
+GPX::Matcher::Match GPX::Matcher::at(int upper) const
+{
+    if (upper == 0 || upper == mTime.size())
+        return {}; // beyond the track time
+
+    if (mTime[upper] - mTime[upper - 1] > mMaxGap && std::binary_search(mSpans.cbegin(), mSpans.cend(), upper))
+        return {}; // between two segments too far apart
+
+    Match match;
+    match.before = mPoint[upper - 1];
+    match.after = mPoint[upper];
+    return match;
+}
+
+GPX::Matcher::Match GPX::Matcher::find(qint64 msecs) const
+{
+    auto i = std::upper_bound(mTime.cbegin(), mTime.cend(), msecs);
+    return at(static_cast<int>(i - mTime.cbegin()));
+}
+
+/// \return true if \a msecs still falls between the points of \a match,
+/// i.e. find(msecs) would return the same match
+bool GPX::Matcher::contains(const Match& match, qint64 msecs) const
+{
+    return match.isValid() && mTrack.msecs(match.before) <= msecs && msecs < mTrack.msecs(match.after);
+}
+
+QVector<GPX::Matcher::Match> GPX::Matcher::sweep(const QVector<qint64>& ascending) const
+{
+    QVector<Match> matches;
+    matches.reserve(ascending.size());
+
+    int upper = 0;
+    for (qint64 msecs: ascending)
+    {
+        while (upper < mTime.size() && mTime[upper] <= msecs)
+            ++upper;
+        matches.append(at(upper));
+    }
+
+    return matches;
+}
+
+/// matches every time of \a msecs; ascending times are matched in a single pass over the track
+QVector<GPX::Matcher::Match> GPX::Matcher::find(const QVector<qint64>& msecs) const
+{
+    if (std::is_sorted(msecs.cbegin(), msecs.cend()))
+        return sweep(msecs);
+
+    QVector<Match> matches;
+    matches.reserve(msecs.size());
+    for (qint64 time: msecs)
+        matches.append(find(time));
+    return matches;
+}
+
+QGeoCoordinate GPX::Matcher::position(const Match& match, qint64 msecs) const
+{
+    if (!match.isValid())
+        return {};
+    return interpolated(mTrack, match.before, match.after, msecs);
+}
@@ -0,0 +1,68 @@
+#ifndef GPX_MATCHER_H
+#define GPX_MATCHER_H
+
+#include <QGeoCoordinate>
+#include <QVector>
+
+#include "track.h"
+
+namespace GPX
+{
+
+/// Time-to-position lookup over a track.
+/// The time index is built once per track: points are ordered by timestamp
+/// (GPS clock jumps make the raw track non-monotonic), points sharing a timestamp
+/// or lacking coordinates are dropped, so every lookup is a binary search
+/// and a batch of ascending times is matched with a single sweep.
+///
+/// The track may be merged from several files, so the index is built segment by segment:
+/// the segments are ordered by their start time, and where a segment overlaps the ones before it,
+/// its overlapping points are skipped. The start of each segment in the index is kept
+/// in a sorted table; a time between two segments more than maxGap() apart has no match.
+class Matcher
+{
+public:
+    /// the pair of track points around the time; interpolate between them
+    struct Match
+    {
+        int before = -1;
+        int after = -1;
+
+        bool isValid() const { return before >= 0; }
+        bool operator ==(const Match& other) const { return before == other.before && after == other.after; }
+        bool operator !=(const Match& other) const { return !(*this == other); }
+    };
+
+    static const qint64 DefaultMaxGap = 60 * 60 * 1000;
+
+    void setTrack(const TrackStore& track);
+    void clear();
+
+    /// the longest break between segments to interpolate over, milliseconds
+    void setMaxGap(qint64 msecs) { mMaxGap = msecs; }
+    qint64 maxGap() const { return mMaxGap; }
+
+    const TrackStore& track() const { return mTrack; }
+    bool isEmpty() const { return mTime.isEmpty(); }
+
+    Match find(qint64 msecs) const;
+    bool contains(const Match& match, qint64 msecs) const;
+    QVector<Match> find(const QVector<qint64>& msecs) const;
+    QGeoCoordinate position(const Match& match, qint64 msecs) const;
+
+private:
+    QVector<Match> sweep(const QVector<qint64>& ascending) const;
+    Match at(int upper) const;
+
+    static const char* mscModuleName;
+
+    TrackStore mTrack;
+    QVector<qint64> mTime;  // strictly ascending
+    QVector<int> mPoint;    // track point for each mTime entry
+    QVector<int> mSpans;    // mTime index of the first entry of each segment, ascending
+    qint64 mMaxGap = DefaultMaxGap;
+};
+
+} // namespace GPX
+
+#endif // GPX_MATCHER_H
@@ -0,0 +1,21 @@
+#ifndef GPX_MERCATOR_H
+#define GPX_MERCATOR_H
+
+#include <QPointF>
+#include <QtMath>
+
+#include <cmath>
+
+namespace GPX
+{
+
+/// Web Mercator projection of the map tiles; the world is [0, 1] x [0, 1], north up
+inline QPointF mercator(double lat, double lon)
+{
+    const double phi = qDegreesToRadians(qBound(-85.05112878, lat, 85.05112878));
+    return { (lon + 180.) / 360., (1. - std::log(std::tan(phi) + 1. / std::cos(phi)) / M_PI) / 2. };
+}
+
+} // namespace GPX
+
+#endif // GPX_MERCATOR_H
@@ -0,0 +1,187 @@
+#include "nmeareader.h"
+
+#include <QDate>
+#include <QList>
+#include <QtMath>
+
+namespace
+{
+
+/// the fix of one epoch, merged from its sentences
+struct Fix
+{
+    int time = -1;      ///< msecs of the day, UTC
+    qint64 day = -1;    ///< since the epoch, if a RMC told it
+    double lat = qQNaN();
+    double lon = qQNaN();
+    double alt = qQNaN();
+};
+
+/// "hhmmss.sss"
+int parseTime(const QByteArray& s)
+{
+    if (s.size() < 6)
+        return -1;
+    bool ok[3];
+    const int h = s.mid(0, 2).toInt(&ok[0]);
+    const int m = s.mid(2, 2).toInt(&ok[1]);
+    const double sec = s.mid(4).toDouble(&ok[2]);
+    if (!ok[0] || !ok[1] || !ok[2] || h > 23 || m > 59 || sec >= 61)
+        return -1;
+    return (h * 60 + m) * 60000 + qRound(sec * 1000);
+}
+
+/// "ddmmyy", the years of GPS before 1980 don't exist
+qint64 parseDate(const QByteArray& s)
+{
+    if (s.size() != 6)
+        return -1;
+    const int year = s.mid(4, 2).toInt();
+    const QDate date(year < 80 ? 2000 + year : 1900 + year, s.mid(2, 2).toInt(), s.mid(0, 2).toInt());
+    return date.isValid() ? date.toJulianDay() - QDate(1970, 1, 1).toJulianDay() : -1;
+}
+
+/// "ddmm.mmmm" or "dddmm.mmmm" with the hemisphere
+double parseCoordinate(const QByteArray& s, const QByteArray& hemisphere)
+{
+    bool ok;
+    const double value = s.toDouble(&ok);
+    if (!ok)
+        return qQNaN();
+    const double degrees = std::floor(value / 100);
+    const double result = degrees + (value - degrees * 100) / 60;
+    return hemisphere == "S" || hemisphere == "W" ? -result : result;
+}
+
+/// the sentence without '$' and the checksum, empty if it is damaged
+QByteArray sentence(const QByteArray& line)
+{
+    if (!line.startsWith('$'))
+        return {};
+
+    const int star = line.lastIndexOf('*');
+    if (star < 0)
+        return line.mid(1);
+
+    quint8 sum = 0;
+    for (int i = 1; i < star; ++i)
+        sum ^= static_cast<quint8>(line[i]);
+    bool ok;
+    if (line.mid(star + 1, 2).toUInt(&ok, 16) != sum || !ok)
+        return {};
+    return line.mid(1, star - 1);
+}
+
+} // namespace
+
+
+bool GPX::NmeaReader::canRead(const QByteArray& head) const
+{
+    // "$GPRMC," and the like, a log may begin with any sentence
+    const QByteArray line = head.left(head.indexOf('\n')).trimmed();
+    if (line.size() < 7 || line[0] != '$' || line[6] != ',')
+        return false;
+    for (int i = 1; i < 6; ++i)
+        if (!QChar::isLetterOrNumber(static_cast<uchar>(line[i])))
+            return false;
+    return head.contains("RMC,") || head.contains("GGA,");
+}
+
+bool GPX::NmeaReader::read(Input* input, TrackStore* track, Statistic* statistic, QString*, QString* error)
+{
+    QIODevice* device = input->device();
+
+    Fix fix;
+    qint64 lastDay = -1;
+    int lastTime = -1;
+    bool gap = false;
+    bool undated = false;
+
+    auto flush = [&]() {
+        if (fix.time >= 0 && !qIsNaN(fix.lat) && !qIsNaN(fix.lon))
+        {
+            // a GGA alone takes the date of the fix before, past midnight the next one
+            qint64 day = fix.day;
+            if (day < 0 && lastDay >= 0)
+                day = fix.time < lastTime ? lastDay + 1 : lastDay;
+
+            if (day < 0) {
+                undated = true;
+            } else {
+                if (gap && !track->isEmpty())
+                    track->beginSegment();
+                gap = false;
+
+                track->append(day * 86400000 + fix.time, fix.lat, fix.lon, fix.alt);
+                statistic->add(fix.lat, fix.lon);
+                lastDay = day;
+                lastTime = fix.time;
+            }
+        }
+        fix = Fix();
+    };
+
+    for (int lines = 1; ; ++lines)
+    {
+        const QByteArray line = device->readLine().trimmed();
+        if (line.isEmpty() && device->atEnd())
+            break;
+
+        if (lines % 4096 == 0 && !input->progress()) {
+            *error = tr("Cancelled");
+            return false;
+        }
+
+        const QList<QByteArray> fields = sentence(line).split(',');
+        if (fields.size() < 10 || fields[0].size() != 5)
+            continue;
+
+        const QByteArray type = fields[0].mid(2);
+        if (type != "RMC" && type != "GGA")
+            continue;
+
+        const int time = parseTime(fields[1]);
+        if (time < 0)
+            continue;
+        if (time != fix.time) {
+            flush();
+            fix.time = time;
+        }
+
+        if (type == "RMC")
+        {
+            // time, status, lat, N/S, lon, E/W, speed, course, date
+            if (fields[2] != "A") {
+                gap = true;
+                continue;
+            }
+            fix.day = parseDate(fields[9]);
+            if (qIsNaN(fix.lat)) {
+                fix.lat = parseCoordinate(fields[3], fields[4]);
+                fix.lon = parseCoordinate(fields[5], fields[6]);
+            }
+        }
+        else
+        {
+            // time, lat, N/S, lon, E/W, quality, satellites, HDOP, altitude
+            if (fields[6].toInt() == 0) {
+                gap = true;
+                continue;
+            }
+            fix.lat = parseCoordinate(fields[2], fields[3]);
+            fix.lon = parseCoordinate(fields[4], fields[5]);
+            bool ok;
+            const double alt = fields[9].toDouble(&ok);
+            if (ok)
+                fix.alt = alt;
+        }
+    }
+    flush();
+
+    // only RMC has the date, without it the time of day is of no use
+    if (track->isEmpty() && undated) {
+        *error = tr("No time information in the track");
+        return false;
+    }
+    return true;
+}
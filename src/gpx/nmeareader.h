@@ -0,0 +1,26 @@
+#ifndef GPX_NMEAREADER_H
+#define GPX_NMEAREADER_H
+
+#include <QCoreApplication>
+
+#include "trackreader.h"
+
+namespace GPX
+{
+
+/// NMEA 0183 sentence logs: RMC gives the date and the position, GGA the position and
+/// the altitude; the sentences of one fix are merged into a point, a lost fix ends a segment.
+class NmeaReader : public Reader
+{
+    Q_DECLARE_TR_FUNCTIONS(GPX::NmeaReader)
+
+public:
+    QString format() const override { return "NMEA"; }
+    QStringList nameFilters() const override { return { "*.nmea", "*.nma", "*.log" }; }
+    bool canRead(const QByteArray& head) const override;
+    bool read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error) override;
+};
+
+} // namespace GPX
+
+#endif // GPX_NMEAREADER_H
@@ -0,0 +1,558 @@
+#include "parser.h"
+
+#include <cstring>
+
+#if defined(__has_include)
+#if __has_include(<charconv>) && __cplusplus >= 201703L
+#include <charconv>
+#endif
+#endif
+
+#include <QByteArray>
+#include <QDateTime>
+
+
+namespace
+{
+
+inline bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+inline bool isDigit(char c) { return static_cast<unsigned>(c - '0') <= 9; }
+
+inline void trim(const char*& begin, const char*& end)
+{
+    while (begin != end && isSpace(*begin))
+        ++begin;
+    while (end != begin && isSpace(end[-1]))
+        --end;
+}
+
+inline const char* find(const char* begin, const char* end, char c)
+{
+    return begin < end ? static_cast<const char*>(memchr(begin, c, end - begin)) : nullptr;
+}
+
+const char* find(const char* begin, const char* end, const char* pattern)
+{
+    const size_t size = strlen(pattern);
+    for (const char* p = find(begin, end, pattern[0]); p; p = find(p + 1, end, pattern[0]))
+        if (static_cast<size_t>(end - p) >= size && memcmp(p, pattern, size) == 0)
+            return p;
+    return nullptr;
+}
+
+inline bool startsWith(const char* begin, const char* end, const char* prefix)
+{
+    const size_t size = strlen(prefix);
+    return static_cast<size_t>(end - begin) >= size && memcmp(begin, prefix, size) == 0;
+}
+
+/// the name without namespace prefix, as QXmlStreamReader::name() has it
+inline bool isLocalName(const char* begin, const char* end, const char* name)
+{
+    for (const char* p = begin; p != end; ++p)
+        if (*p == ':')
+            begin = p + 1;
+    const size_t size = strlen(name);
+    return static_cast<size_t>(end - begin) == size && memcmp(begin, name, size) == 0;
+}
+
+/// character data with the predefined and numeric references resolved
+bool decode(const char* begin, const char* end, QString* text)
+{
+    QByteArray utf8;
+    for (const char* amp = find(begin, end, '&'); amp; amp = find(begin, end, '&'))
+    {
+        utf8.append(begin, static_cast<int>(amp - begin));
+
+        const char* semicolon = find(amp, end, ';');
+        if (!semicolon)
+            return false;
+
+        const QByteArray entity(amp + 1, static_cast<int>(semicolon - amp - 1));
+        if (entity == "amp")
+            utf8 += '&';
+        else if (entity == "lt")
+            utf8 += '<';
+        else if (entity == "gt")
+            utf8 += '>';
+        else if (entity == "quot")
+            utf8 += '"';
+        else if (entity == "apos")
+            utf8 += '\'';
+        else if (entity.startsWith('#'))
+        {
+            bool ok = false;
+            const uint code = entity.startsWith("#x") ? entity.mid(2).toUInt(&ok, 16) : entity.mid(1).toUInt(&ok);
+            if (!ok)
+                return false;
+            utf8 += QString::fromUcs4(&code, 1).toUtf8();
+        }
+        else
+            return false; // declared in a DTD
+
+        begin = semicolon + 1;
+    }
+    utf8.append(begin, static_cast<int>(end - begin));
+
+    *text = QString::fromUtf8(utf8);
+    if (text->contains('\r')) // XML end-of-line handling
+        text->replace("\r\n", "\n").replace('\r', '\n');
+    return true;
+}
+
+inline qint64 daysFromCivil(int year, unsigned month, unsigned day)
+{
+    // days since 1970-01-01 in the proleptic Gregorian calendar, the year is shifted to begin in March
+    year -= month <= 2;
+    const int era = year / 400;
+    const unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+    const unsigned dayOfYear = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return static_cast<qint64>(era) * 146097 + dayOfEra - 719468;
+}
+
+inline unsigned daysInMonth(int year, unsigned month)
+{
+    static const unsigned Days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+    const bool leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+    return Days[month - 1] + (month == 2 && leap);
+}
+
+} // namespace
+
+
+GPX::Parser::Parser(TrackStore* track, Statistic* statistic, QString* name)
+    : mTrack(track)
+    , mStatistic(statistic)
+    , mName(name)
+{
+}
+
+GPX::Parser::Result GPX::Parser::parse(const char* begin, const char* end, bool complete)
+{
+    static const qint64 ProgressStep = 1 << 20;
+
+    const char* p = begin;
+
+    // the UTF-8 BOM is fine, UTF-16 and UTF-32 are left to QXmlStreamReader
+    if (startsWith(p, end, "\xEF\xBB\xBF"))
+        p += 3;
+    else if (p != end && (*p == '\0' || *p == '\xFE' || *p == '\xFF'))
+        return Unsupported;
+
+    const char* reported = p;
+    Result result = Parsed;
+
+    // text outside the values is of no interest, so the scan goes from one '<' to the next
+    while ((p = find(p, end, '<')))
+    {
+        if (++p == end)
+            return Unsupported;
+
+        if (*p == '/')
+            p = endTag(p + 1, end, &result);
+        else if (*p == '?')
+            p = instruction(p + 1, end, &result);
+        else if (*p == '!')
+            p = declaration(p + 1, end, &result);
+        else
+            p = startTag(p, end, &result);
+
+        if (!p)
+            return result;
+
+        if (p - reported >= ProgressStep) {
+            reported = p;
+            if (mProgress && !mProgress(p - begin))
+                return Stopped;
+        }
+    }
+
+    // a truncated document is left to the XML reader, which loads what is before the error
+    return !complete || mDepth == 0 ? Parsed : Unsupported;
+}
+
+void GPX::Parser::resumeInSegment()
+{
+    mPath[0] = Gpx;
+    mPath[1] = Trk;
+    mPath[2] = Trkseg;
+    mDepth = mKnown = 3;
+}
+
+const char* GPX::Parser::findPoint(const char* begin, const char* end)
+{
+    for (const char* p = find(begin, end, "<trkpt"); p; p = find(p + 6, end, "<trkpt"))
+        if (end - p > 6 && (isSpace(p[6]) || p[6] == '>' || p[6] == '/'))
+            return p;
+    return nullptr;
+}
+
+const char* GPX::Parser::findLastPoint(const char* begin, const char* end)
+{
+    if (end - begin < 7)
+        return nullptr;
+    for (const char* p = end - 7; p >= begin; --p)
+        if (*p == '<' && memcmp(p + 1, "trkpt", 5) == 0 && (isSpace(p[6]) || p[6] == '>' || p[6] == '/'))
+            return p;
+    return nullptr;
+}
+
+const char* GPX::Parser::startTag(const char* p, const char* end, Result* result)
+{
+    *result = Unsupported;
+
+    const char* name = p;
+    while (p != end && !isSpace(*p) && *p != '>' && *p != '/')
+        ++p;
+
+    Kind kind = Other;
+    switch (parent())
+    {
+    case Root:
+        if (isLocalName(name, p, "gpx"))
+            kind = Gpx;
+        break;
+    case Gpx:
+        if (isLocalName(name, p, "trk"))
+            kind = Trk;
+        break;
+    case Trk:
+        if (isLocalName(name, p, "trkseg"))
+            kind = Trkseg;
+        else if (isLocalName(name, p, "name"))
+            kind = Name;
+        break;
+    case Trkseg:
+        if (isLocalName(name, p, "trkpt")) {
+            kind = Trkpt;
+            mLat = mLon = 0.;
+            mAlt = qQNaN();
+            mHasTime = false;
+        }
+        break;
+    case Trkpt:
+        if (isLocalName(name, p, "ele"))
+            kind = Ele;
+        else if (isLocalName(name, p, "time"))
+            kind = Time;
+        break;
+    default:
+        break;
+    }
+
+    bool empty = false;
+    for (;;)
+    {
+        while (p != end && isSpace(*p))
+            ++p;
+        if (p == end)
+            return nullptr;
+        if (*p == '>') {
+            ++p;
+            break;
+        }
+        if (*p == '/') {
+            if (end - p < 2 || p[1] != '>')
+                return nullptr;
+            empty = true;
+            p += 2;
+            break;
+        }
+
+        const char* attribute = p;
+        while (p != end && *p != '=' && !isSpace(*p) && *p != '>' && *p != '/')
+            ++p;
+        const char* attributeEnd = p;
+
+        while (p != end && isSpace(*p))
+            ++p;
+        if (p == end || *p != '=')
+            return nullptr;
+        ++p;
+        while (p != end && isSpace(*p))
+            ++p;
+        if (p == end || (*p != '"' && *p != '\''))
+            return nullptr;
+
+        const char* value = p + 1;
+        const char* valueEnd = find(value, end, *p);
+        if (!valueEnd)
+            return nullptr;
+        p = valueEnd + 1;
+
+        if (kind == Trkpt)
+        {
+            double* coordinate = isLocalName(attribute, attributeEnd, "lat") ? &mLat
+                               : isLocalName(attribute, attributeEnd, "lon") ? &mLon : nullptr;
+            // not a number is read as 0, as QStringRef::toDouble() does
+            if (coordinate && !parseDouble(value, valueEnd, coordinate)) {
+                if (find(value, valueEnd, '&'))
+                    return nullptr;
+                *coordinate = 0.;
+            }
+        }
+    }
+
+    if (kind == Name || kind == Ele || kind == Time)
+    {
+        // the values are read right away, so they are never on the path
+        const char* text = p;
+        const char* textEnd = p;
+        if (!empty) {
+            // comments, CDATA sections or elements inside are left to the XML reader
+            textEnd = find(p, end, '<');
+            if (!textEnd || end - textEnd < 2 || textEnd[1] != '/' || !(p = find(textEnd, end, '>')))
+                return nullptr;
+            ++p;
+        }
+        if (!value(kind, text, textEnd))
+            return nullptr;
+
+        *result = Parsed;
+        return p;
+    }
+
+    if (kind == Trkseg)
+        mTrack->beginSegment();
+
+    *result = Parsed;
+    if (empty) {
+        if (kind == Trkpt && (*result = point()) != Parsed)
+            return nullptr;
+        return p;
+    }
+
+    if (kind != Other)
+        mPath[mKnown++] = kind;
+    ++mDepth;
+    return p;
+}
+
+const char* GPX::Parser::endTag(const char* p, const char* end, Result* result)
+{
+    *result = Unsupported;
+
+    p = find(p, end, '>');
+    if (!p || mDepth == 0)
+        return nullptr;
+
+    if (mDepth-- == mKnown && mPath[--mKnown] == Trkpt && (*result = point()) != Parsed)
+        return nullptr;
+
+    *result = Parsed;
+    return p + 1;
+}
+
+const char* GPX::Parser::instruction(const char* p, const char* end, Result* result)
+{
+    *result = Unsupported;
+
+    const char* close = find(p, end, "?>");
+    if (!close)
+        return nullptr;
+
+    if (startsWith(p, close, "xml") && close - p > 3 && isSpace(p[3]))
+    {
+        // the declaration, nothing but UTF-8 and its ASCII subset is read here
+        if (const char* encoding = find(p, close, "encoding"))
+        {
+            const char* value = encoding + 8;
+            while (value != close && (isSpace(*value) || *value == '=' || *value == '"' || *value == '\''))
+                ++value;
+            const char* valueEnd = value;
+            while (valueEnd != close && *valueEnd != '"' && *valueEnd != '\'')
+                ++valueEnd;
+
+            const QByteArray name = QByteArray(value, static_cast<int>(valueEnd - value)).toLower();
+            if (name != "utf-8" && name != "utf8" && name != "us-ascii" && name != "ascii")
+                return nullptr;
+        }
+    }
+
+    *result = Parsed;
+    return close + 2;
+}
+
+const char* GPX::Parser::declaration(const char* p, const char* end, Result* result)
+{
+    *result = Unsupported;
+
+    if (startsWith(p, end, "--")) {
+        p = find(p + 2, end, "-->");
+        if (!p)
+            return nullptr;
+        *result = Parsed;
+        return p + 3;
+    }
+
+    if (startsWith(p, end, "[CDATA[")) {
+        // the values are read in startTag(), so this one is of no interest
+        p = find(p + 7, end, "]]>");
+        if (!p)
+            return nullptr;
+        *result = Parsed;
+        return p + 3;
+    }
+
+    // DOCTYPE, the internal subset may declare entities
+    for (; p != end; ++p)
+    {
+        if (*p == '"' || *p == '\'') {
+            if (!(p = find(p + 1, end, *p)))
+                return nullptr;
+        }
+        else if (*p == '[')
+            return nullptr;
+        else if (*p == '>') {
+            *result = Parsed;
+            return p + 1;
+        }
+    }
+    return nullptr;
+}
+
+bool GPX::Parser::value(Kind kind, const char* begin, const char* end)
+{
+    switch (kind)
+    {
+    case Name:
+        return decode(begin, end, mName);
+    case Ele:
+        if (!parseDouble(begin, end, &mAlt)) {
+            if (find(begin, end, '&'))
+                return false;
+            mAlt = 0.;
+        }
+        return true;
+    case Time:
+        if (find(begin, end, '&'))
+            return false;
+        mHasTime = parseTime(begin, end, &mTime);
+        return true;
+    default:
+        return true;
+    }
+}
+
+GPX::Parser::Result GPX::Parser::point()
+{
+    if (!mHasTime)
+        return NoTimestamp;
+
+    mTrack->append(mTime, mLat, mLon, mAlt);
+    mStatistic->add(mLat, mLon);
+    return Parsed;
+}
+
+bool GPX::Parser::parseTime(const char* begin, const char* end, qint64* msecs)
+{
+    trim(begin, end);
+    if (end - begin < 19)
+        return false;
+
+    // the fixed part "YYYY-MM-DDThh:mm:ss" is checked as a whole, not digit by digit
+    static const int Digits[14] = { 0, 1, 2, 3, 5, 6, 8, 9, 11, 12, 14, 15, 17, 18 };
+    const unsigned char* s = reinterpret_cast<const unsigned char*>(begin);
+
+    unsigned d[14];
+    unsigned bad = (s[4] ^ '-') | (s[7] ^ '-') | ((s[10] | 0x20) ^ 't') | (s[13] ^ ':') | (s[16] ^ ':');
+    for (int i = 0; i < 14; ++i) {
+        d[i] = static_cast<unsigned>(s[Digits[i]] - '0');
+        bad |= d[i] > 9;
+    }
+
+    const int year = static_cast<int>(d[0] * 1000 + d[1] * 100 + d[2] * 10 + d[3]);
+    const unsigned month = d[4] * 10 + d[5];
+    const unsigned day = d[6] * 10 + d[7];
+    const unsigned hour = d[8] * 10 + d[9];
+    const unsigned minute = d[10] * 10 + d[11];
+    const unsigned second = d[12] * 10 + d[13];
+
+    bad |= (year == 0) | (month - 1 > 11) | (day - 1 > 30) | (hour > 23) | (minute > 59) | (second > 59);
+    if (bad || day > daysInMonth(year, month))
+        return false;
+
+    const char* p = begin + 19;
+
+    int msec = 0;
+    if (p != end && (*p == '.' || *p == ',')) {
+        const char* fraction = ++p;
+        for (int scale = 100; p != end && isDigit(*p); ++p, scale /= 10)
+            msec += (*p - '0') * scale;
+        if (p == fraction)
+            return false;
+    }
+
+    if (p == end) {
+        *msecs = QDateTime(QDate(year, static_cast<int>(month), static_cast<int>(day)),
+                           QTime(static_cast<int>(hour), static_cast<int>(minute), static_cast<int>(second), msec))
+                     .toMSecsSinceEpoch();
+        return true;
+    }
+
+    qint64 offset = 0;
+    if ((*p | 0x20) == 'z') {
+        if (++p != end)
+            return false;
+    }
+    else if (*p == '+' || *p == '-') {
+        // "+hh:mm" or "+hhmm"
+        const bool colon = end - p == 6 && p[3] == ':';
+        if (!colon && end - p != 5)
+            return false;
+        const char* m = p + (colon ? 4 : 3);
+        if (!isDigit(p[1]) || !isDigit(p[2]) || !isDigit(m[0]) || !isDigit(m[1]))
+            return false;
+        offset = ((p[1] - '0') * 10 + (p[2] - '0')) * 60 + (m[0] - '0') * 10 + (m[1] - '0');
+        offset *= *p == '-' ? -60000 : 60000;
+    }
+    else
+        return false;
+
+    const qint64 seconds = ((daysFromCivil(year, month, day) * 24 + hour) * 60 + minute) * 60 + second;
+    *msecs = seconds * 1000 + msec - offset;
+    return true;
+}
+
+bool GPX::Parser::parseDouble(const char* begin, const char* end, double* value)
+{
+    trim(begin, end);
+    if (begin != end && *begin == '+')
+        ++begin;
+
+#if defined(__cpp_lib_to_chars)
+    const std::from_chars_result parsed = std::from_chars(begin, end, *value);
+    return parsed.ec == std::errc() && parsed.ptr == end;
+#else
+    // up to 15 digits are exact in a double, so a single division by an exact power of ten
+    // is rounded the same way as strtod() does; longer numbers take the general way
+    static const double Pow10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+    const char* p = begin;
+    const bool negative = p != end && *p == '-';
+    if (negative)
+        ++p;
+
+    quint64 mantissa = 0;
+    int digits = 0;
+    int scale = 0;
+    for (; p != end && isDigit(*p); ++p, ++digits)
+        mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+    if (p != end && *p == '.')
+        for (++p; p != end && isDigit(*p); ++p, ++digits, ++scale)
+            mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+
+    if (p == end && digits > 0 && digits <= 15) {
+        const double number = static_cast<double>(mantissa) / Pow10[scale];
+        *value = negative ? -number : number;
+        return true;
+    }
+
+    bool ok = false;
+    *value = QByteArray::fromRawData(begin, static_cast<int>(end - begin)).toDouble(&ok);
+    return ok;
+#endif
+}
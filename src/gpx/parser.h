@@ -0,0 +1,89 @@
+#ifndef GPX_PARSER_H
+#define GPX_PARSER_H
+
+#include <functional>
+
+#include <QString>
+
+#include "statistic.h"
+#include "track.h"
+
+namespace GPX
+{
+
+/// Byte-level parser for the part of GPX the loader reads: gpx/trk/name and
+/// gpx/trk/trkseg/trkpt with its lat, lon attributes and ele, time children.
+/// It works on a UTF-8 buffer and checks only what it needs; a document it does not
+/// handle (other encodings, CDATA or child elements in the values, internal DTD subset)
+/// is reported as Unsupported, to be read again by QXmlStreamReader.
+class Parser
+{
+public:
+    enum Result
+    {
+        Parsed,
+        Unsupported,
+        NoTimestamp, ///< a track point without a valid time
+        Stopped      ///< the progress callback returned false
+    };
+
+    /// the results are appended to \a track, \a statistic and \a name as they are read
+    Parser(TrackStore* track, Statistic* statistic, QString* name);
+
+    /// \a progress gets the bytes consumed from time to time and returns false to stop
+    void setProgress(const std::function<bool(qint64)>& progress) { mProgress = progress; }
+
+    /// a chunk that is not \a complete may end with elements open, to be resumed by another parser
+    Result parse(const char* begin, const char* end, bool complete = true);
+
+    /// goes on as if gpx/trk/trkseg were open, to parse a chunk that begins at a track point
+    void resumeInSegment();
+    /// true if gpx/trk/trkseg and nothing else is open, where a chunk is resumed
+    bool isInSegment() const { return mDepth == 3 && mKnown == 3 && mPath[2] == Trkseg; }
+
+    /// the next and the last "<trkpt" tags, places to split the document at
+    static const char* findPoint(const char* begin, const char* end);
+    static const char* findLastPoint(const char* begin, const char* end);
+
+    /// "YYYY-MM-DDThh:mm:ss" with optional fraction and 'Z' or "+hh:mm" suffix;
+    /// the time without suffix is local, as QDateTime::fromString() reads it
+    static bool parseTime(const char* begin, const char* end, qint64* msecs);
+    static bool parseDouble(const char* begin, const char* end, double* value);
+
+private:
+    enum Kind { Root, Gpx, Trk, Trkseg, Trkpt, Name, Ele, Time, Other };
+
+    // each takes the position after '<' and returns the one after the markup or nullptr
+    // with \a result set
+    const char* startTag(const char* p, const char* end, Result* result);
+    const char* endTag(const char* p, const char* end, Result* result);
+    const char* instruction(const char* p, const char* end, Result* result);
+    const char* declaration(const char* p, const char* end, Result* result);
+
+    bool value(Kind kind, const char* begin, const char* end);
+    Result point();
+
+    Kind parent() const { return mDepth > mKnown ? Other : mKnown ? mPath[mKnown - 1] : Root; }
+
+    TrackStore* mTrack;
+    Statistic* mStatistic;
+    QString* mName;
+    std::function<bool(qint64)> mProgress;
+
+    // the element depth and the known containers on the path, the elements below
+    // any other one are of no interest
+    int mDepth = 0;
+    int mKnown = 0;
+    Kind mPath[4];
+
+    // the point being read
+    double mLat = 0.;
+    double mLon = 0.;
+    double mAlt = 0.;
+    qint64 mTime = 0;
+    bool mHasTime = false;
+};
+
+} // namespace GPX
+
+#endif // GPX_PARSER_H
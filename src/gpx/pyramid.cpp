@@ -0,0 +1,136 @@
+#include "pyramid.h"
+
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "mercator.h"
+
+namespace
+{
+
+/// distance from \a p to the line segment between \a a and \a b
+double distance(const QPointF& p, const QPointF& a, const QPointF& b)
+{
+    const double dx = b.x() - a.x();
+    const double dy = b.y() - a.y();
+    const double length = dx * dx + dy * dy;
+
+    double t = length > 0. ? ((p.x() - a.x()) * dx + (p.y() - a.y()) * dy) / length : 0.;
+    t = qBound(0., t, 1.);
+
+    return std::hypot(p.x() - a.x() - t * dx, p.y() - a.y() - t * dy);
+}
+
+/// the lowest zoom level at which \a significance is over half a pixel
+int minZoom(double significance)
+{
+    if (significance >= 1.)
+        return 0;
+    if (significance <= 0.)
+        return GPX::Pyramid::MaxZoom + 1; // never shown
+
+    // half a pixel at zoom z is 1 / (512 * 2^z)
+    const int zoom = static_cast<int>(std::ceil(-std::log2(significance * 512.)));
+    return qBound(0, zoom, GPX::Pyramid::MaxZoom + 1);
+}
+
+} // namespace
+
+GPX::Pyramid GPX::Pyramid::build(const TrackStore& track)
+{
+    const int size = track.size();
+
+    QVector<QPointF> points(size);
+    for (int i = 0; i < size; ++i)
+        points[i] = mercator(track.latitude(i), track.longitude(i));
+
+    // Douglas-Peucker without a tolerance: every point gets the distance it was split at,
+    // capped by the one of its parent range, so a point never appears before the points
+    // its range was cut at
+    QVector<double> significance(size, 0.);
+
+    struct Range { int first, last; double limit; };
+    QVector<Range> stack;
+    for (int segment = 0; segment < track.segmentCount(); ++segment)
+    {
+        const int first = track.segmentBegin(segment);
+        const int last = track.segmentEnd(segment) - 1;
+        if (last < first)
+            continue;
+
+        significance[first] = significance[last] = std::numeric_limits<double>::infinity();
+        stack.append({ first, last, std::numeric_limits<double>::infinity() });
+
+        while (!stack.isEmpty())
+        {
+            const Range range = stack.takeLast();
+            if (range.last - range.first < 2)
+                continue;
+
+            int split = -1;
+            double farthest = -1.;
+            for (int i = range.first + 1; i < range.last; ++i)
+            {
+                const double d = distance(points[i], points[range.first], points[range.last]);
+                if (d > farthest) {
+                    farthest = d;
+                    split = i;
+                }
+            }
+
+            if (split < 0)
+                continue; // no coordinates
+
+            significance[split] = std::min(farthest, range.limit);
+            stack.append({ range.first, split, significance[split] });
+            stack.append({ split, range.last, significance[split] });
+        }
+    }
+
+    Pyramid pyramid;
+    pyramid.mAdded.resize(MaxZoom + 1);
+    for (int i = 0; i < size; ++i)
+    {
+        const int zoom = minZoom(significance[i]);
+        if (zoom <= MaxZoom)
+            pyramid.mAdded[zoom].append(i);
+    }
+
+    pyramid.mCount.resize(MaxZoom + 1);
+    int count = 0;
+    for (int zoom = 0; zoom <= MaxZoom; ++zoom)
+    {
+        pyramid.mAdded[zoom].squeeze();
+        pyramid.mCount[zoom] = count += pyramid.mAdded[zoom].size();
+    }
+
+    return pyramid;
+}
+
+int GPX::Pyramid::level(double zoom, int maxPoints) const
+{
+    if (mCount.isEmpty())
+        return -1;
+
+    int level = qBound(0, static_cast<int>(std::ceil(zoom)), MaxZoom);
+    while (level > 0 && mCount[level] > maxPoints)
+        --level;
+    return level;
+}
+
+QVector<int> GPX::Pyramid::points(int level) const
+{
+    QVector<int> points;
+    if (level < 0 || level >= mCount.size())
+        return points;
+
+    points.reserve(mCount[level]);
+    for (int zoom = 0; zoom <= level; ++zoom)
+        points += mAdded[zoom];
+
+    std::sort(points.begin(), points.end());
+    return points;
+}
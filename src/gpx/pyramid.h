@@ -0,0 +1,43 @@
+#ifndef GPX_PYRAMID_H
+#define GPX_PYRAMID_H
+
+#include <QVector>
+
+#include "track.h"
+
+namespace GPX
+{
+
+/// Multi-resolution track for the map.
+/// Douglas-Peucker runs once over each segment in Web Mercator coordinates and records
+/// the tolerance at which every point stops being dropped; that gives each point the lowest
+/// map zoom level it is visible at (about half a pixel off the line, 256-pixel tiles).
+/// A level is the points of all the levels up to it, in track order, so any level
+/// is cut from the pyramid without simplifying again.
+class Pyramid
+{
+public:
+    static const int MaxZoom = 20;
+
+    /// heavy, run it in a worker thread
+    static Pyramid build(const TrackStore& track);
+
+    bool isEmpty() const { return mCount.isEmpty() || mCount.last() == 0; }
+
+    /// the finest level not above \a zoom having at most \a maxPoints points,
+    /// or the coarsest one if none of them fits
+    int level(double zoom, int maxPoints) const;
+
+    int size(int level) const { return mCount[level]; }
+
+    /// track point indices of \a level, ascending
+    QVector<int> points(int level) const;
+
+private:
+    QVector<QVector<int>> mAdded; // the points appearing at each level
+    QVector<int> mCount;          // the points of each level including the coarser ones
+};
+
+} // namespace GPX
+
+#endif // GPX_PYRAMID_H
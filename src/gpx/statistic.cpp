@@ -26,6 +26,18 @@ void Statistic::add(double lat, double lon)
     }
 }
 
+/// merges the points counted by \a other
+void Statistic::add(const Statistic& other)
+{
+    mSum += other.mSum;
+    mTotal += other.mTotal;
+
+    mLatMin = std::min(other.mLatMin, mLatMin);
+    mLatMax = std::max(other.mLatMax, mLatMax);
+    mLonMin = std::min(other.mLonMin, mLonMin);
+    mLonMax = std::max(other.mLonMax, mLonMax);
+}
+
 void Statistic::clear()
 {
     mTotal = 0;
@@ -11,6 +11,7 @@ class Statistic
 public:
     Statistic();
     void add(double lat, double lon);
+    void add(const Statistic& other);
     void clear();
 
     int total() const;
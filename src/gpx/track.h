@@ -1,14 +1,116 @@
 #ifndef GPX_TRACK_H
 #define GPX_TRACK_H
 
-#include <QGeoPositionInfo>
-#include <QList>
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include <QVector>
+#include <QtNumeric>
 
 namespace GPX
 {
 
-using Segment = QList<QGeoPositionInfo>;
-using Track = QList<Segment>;
+/// Track points in a structure-of-arrays layout: timestamps are milliseconds since epoch (UTC)
+/// and coordinates are plain doubles, each in its own contiguous array.
+/// Segments are stored as offsets of their first points; segment i is [segmentBegin(i), segmentEnd(i)).
+class TrackStore
+{
+    QVector<qint64> mTime;
+    QVector<double> mLat;
+    QVector<double> mLon;
+    QVector<double> mAlt; // NaN if unknown
+    QVector<int> mSegments;
+
+public:
+    void clear() {
+        mTime.clear();
+        mLat.clear();
+        mLon.clear();
+        mAlt.clear();
+        mSegments.clear();
+    }
+
+    void reserve(int points) {
+        mTime.reserve(points);
+        mLat.reserve(points);
+        mLon.reserve(points);
+        mAlt.reserve(points);
+    }
+
+    /// release the capacity left after loading
+    void squeeze() {
+        mTime.squeeze();
+        mLat.squeeze();
+        mLon.squeeze();
+        mAlt.squeeze();
+        mSegments.squeeze();
+    }
+
+    /// all points appended after this call belong to a new segment
+    void beginSegment() { mSegments.append(size()); }
+
+    void append(qint64 msecs, double lat, double lon, double alt = qQNaN()) {
+        if (mSegments.isEmpty())
+            beginSegment();
+        mTime.append(msecs);
+        mLat.append(lat);
+        mLon.append(lon);
+        mAlt.append(alt);
+    }
+
+    /// appends the segments of \a other as they are
+    void append(const TrackStore& other) {
+        for (int segment = 0; segment < other.segmentCount(); ++segment)
+            mSegments.append(size() + other.segmentBegin(segment));
+        mTime += other.mTime;
+        mLat += other.mLat;
+        mLon += other.mLon;
+        mAlt += other.mAlt;
+    }
+
+    /// appends \a other parsed on from a point inside the last segment, so the first
+    /// segment of \a other continues that one
+    void appendContinued(const TrackStore& other) {
+        for (int segment = mSegments.isEmpty() ? 0 : 1; segment < other.segmentCount(); ++segment)
+            mSegments.append(size() + other.segmentBegin(segment));
+        mTime += other.mTime;
+        mLat += other.mLat;
+        mLon += other.mLon;
+        mAlt += other.mAlt;
+    }
+
+    /// takes the arrays as they are, e.g. restored from a snapshot; the point arrays must be of the same size
+    void assign(const QVector<qint64>& time, const QVector<double>& lat, const QVector<double>& lon,
+                const QVector<double>& alt, const QVector<int>& segments) {
+        Q_ASSERT(lat.size() == time.size() && lon.size() == time.size() && alt.size() == time.size());
+        mTime = time;
+        mLat = lat;
+        mLon = lon;
+        mAlt = alt;
+        mSegments = segments;
+    }
+
+    bool isEmpty() const { return mTime.isEmpty(); }
+    int size() const { return mTime.size(); }
+
+    int segmentCount() const { return mSegments.size(); }
+    int segmentBegin(int segment) const { return mSegments[segment]; }
+    int segmentEnd(int segment) const { return segment + 1 < mSegments.size() ? mSegments[segment + 1] : size(); }
+
+    qint64 msecs(int i) const { return mTime[i]; }
+    double latitude(int i) const { return mLat[i]; }
+    double longitude(int i) const { return mLon[i]; }
+    double altitude(int i) const { return mAlt[i]; }
+
+    QDateTime timestamp(int i) const { return QDateTime::fromMSecsSinceEpoch(mTime[i]); }
+    QGeoCoordinate coordinate(int i) const {
+        return qIsNaN(mAlt[i]) ? QGeoCoordinate(mLat[i], mLon[i]) : QGeoCoordinate(mLat[i], mLon[i], mAlt[i]);
+    }
+
+    const QVector<qint64>& times() const { return mTime; }
+    const QVector<double>& latitudes() const { return mLat; }
+    const QVector<double>& longitudes() const { return mLon; }
+    const QVector<double>& altitudes() const { return mAlt; }
+};
 
 } // namespace GPX
 
@@ -0,0 +1,246 @@
+#include "trackreader.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cstring>
+#include <vector>
+
+#include "fitreader.h"
+#include "geojsonreader.h"
+#include "gpxreader.h"
+#include "kmlreader.h"
+#include "nmeareader.h"
+
+namespace
+{
+
+std::vector<GPX::Reader::Factory>& factories()
+{
+    // the binary format first, its magic is the most reliable
+    static std::vector<GPX::Reader::Factory> list = {
+        []() -> GPX::Reader* { return new GPX::FitReader; },
+        []() -> GPX::Reader* { return new GPX::GpxReader; },
+        []() -> GPX::Reader* { return new GPX::KmlReader; },
+        []() -> GPX::Reader* { return new GPX::GeoJsonReader; },
+        []() -> GPX::Reader* { return new GPX::NmeaReader; },
+    };
+    return list;
+}
+
+} // namespace
+
+
+GPX::Input::Input(QFile* file, Decompressor::Format format,
+                  const std::function<bool(qint64)>& progress, const std::function<bool()>& cancelled)
+    : mFile(file)
+    , mFormat(format)
+    , mProgress(progress)
+    , mCancelled(cancelled)
+{
+}
+
+GPX::Input::~Input()
+{
+    if (mMapped)
+        mFile->unmap(mMapped);
+}
+
+bool GPX::Input::open()
+{
+    mDecompressor.reset();
+    mDevice = nullptr;
+
+    if (!mFile->seek(0)) {
+        mErrorString = mFile->errorString();
+        return false;
+    }
+
+    if (mFormat == Decompressor::Plain) {
+        mDevice = mFile;
+        return true;
+    }
+
+    mDecompressor.reset(new Decompressor(mFile, mFormat));
+    if (!mDecompressor->open(QIODevice::ReadOnly)) {
+        mErrorString = mDecompressor->errorString();
+        return false;
+    }
+
+    mDevice = mDecompressor.get();
+    return true;
+}
+
+QByteArray GPX::Input::head() const
+{
+    return mDevice ? mDevice->peek(4096) : QByteArray();
+}
+
+const char* GPX::Input::map()
+{
+    if (!mMapped && mFormat == Decompressor::Plain && mFile->size() > 0)
+        mMapped = mFile->map(0, mFile->size());
+    return reinterpret_cast<const char*>(mMapped);
+}
+
+qint64 GPX::Input::size() const
+{
+    return mFile->size();
+}
+
+qint64 GPX::Input::pos() const
+{
+    return mFile->pos();
+}
+
+
+void GPX::Reader::add(const Factory& factory)
+{
+    factories().push_back(factory);
+}
+
+std::unique_ptr<GPX::Reader> GPX::Reader::create(const QByteArray& head, const QString& fileName)
+{
+    for (const Factory& factory: factories())
+    {
+        std::unique_ptr<Reader> reader(factory());
+        if (reader->canRead(head))
+            return reader;
+    }
+
+    QString name = QFileInfo(fileName).fileName();
+    for (QLatin1String suffix: { QLatin1String(".gz"), QLatin1String(".zst"), QLatin1String(".bz2") })
+        if (name.endsWith(suffix, Qt::CaseInsensitive))
+            name.chop(suffix.size());
+
+    for (const Factory& factory: factories())
+    {
+        std::unique_ptr<Reader> reader(factory());
+        if (!name.isEmpty() && QDir::match(reader->nameFilters(), name))
+            return reader;
+    }
+    return nullptr;
+}
+
+QStringList GPX::Reader::allNameFilters()
+{
+    QStringList suffixes = { QString() };
+    for (Decompressor::Format format: { Decompressor::Gzip, Decompressor::Zstd, Decompressor::Bzip2 })
+        if (Decompressor::isSupported(format))
+            suffixes.append(format == Decompressor::Gzip ? ".gz" : format == Decompressor::Zstd ? ".zst" : ".bz2");
+
+    QStringList filters;
+    for (const Factory& factory: factories())
+        for (const QString& filter: std::unique_ptr<Reader>(factory())->nameFilters())
+            for (const QString& suffix: suffixes)
+                filters.append(filter + suffix);
+    return filters;
+}
+
+QByteArray GPX::Reader::ascii(const QByteArray& head)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(head.constData());
+    const int size = head.size();
+    auto starts = [p, size](const char* bytes, int n) { return size >= n && std::memcmp(p, bytes, n) == 0; };
+
+    // by the BOM, or by the '<' the document begins with if there is none
+    int width = 1, bom = 0;
+    bool bigEndian = false;
+    if (starts("\x00\x00\xFE\xFF", 4))
+        width = 4, bom = 4, bigEndian = true;
+    else if (starts("\xFF\xFE\x00\x00", 4))
+        width = 4, bom = 4;
+    else if (starts("\xFE\xFF", 2))
+        width = 2, bom = 2, bigEndian = true;
+    else if (starts("\xFF\xFE", 2))
+        width = 2, bom = 2;
+    else if (starts("\xEF\xBB\xBF", 3))
+        bom = 3;
+    else if (starts("\x00\x00\x00<", 4))
+        width = 4, bigEndian = true;
+    else if (starts("<\x00\x00\x00", 4))
+        width = 4;
+    else if (starts("\x00<", 2))
+        width = 2, bigEndian = true;
+    else if (starts("<\x00", 2))
+        width = 2;
+
+    if (width == 1)
+        return head.mid(bom);
+
+    QByteArray text;
+    text.reserve((size - bom) / width);
+    for (int i = bom; i + width <= size; i += width)
+    {
+        quint32 unit = 0;
+        for (int k = 0; k < width; ++k)
+            unit = unit << 8 | p[i + (bigEndian ? k : width - 1 - k)];
+        text += unit < 0x80 ? static_cast<char>(unit) : '?';
+    }
+    return text;
+}
+
+QByteArray GPX::Reader::xmlRoot(const QByteArray& content)
+{
+    const QByteArray head = ascii(content);
+    int i = 0;
+    for (;;)
+    {
+        while (i < head.size() && QChar::isSpace(static_cast<uchar>(head[i])))
+            ++i;
+        if (i >= head.size() || head[i] != '<')
+            return {};
+
+        // the declaration, comments and DOCTYPE come before the root
+        if (head.mid(i, 2) == "<?" || head.mid(i, 4) == "<!--")
+        {
+            const QByteArray close = head[i + 1] == '?' ? "?>" : "-->";
+            const int found = head.indexOf(close, i + 2);
+            if (found < 0)
+                return {};
+            i = found + close.size();
+        }
+        else if (head.mid(i, 2) == "<!")
+        {
+            // the internal subset in brackets has markup declarations, comments and quoted values of its own
+            int depth = 0;
+            char quote = 0;
+            for (i += 2; i < head.size(); ++i)
+            {
+                const char c = head[i];
+                if (quote) {
+                    if (c == quote)
+                        quote = 0;
+                } else if (c == '"' || c == '\'') {
+                    quote = c;
+                } else if (c == '[') {
+                    ++depth;
+                } else if (c == ']') {
+                    --depth;
+                } else if (depth > 0 && head.mid(i, 4) == "<!--") {
+                    const int found = head.indexOf("-->", i + 4);
+                    if (found < 0)
+                        return {};
+                    i = found + 2;
+                } else if (c == '>' && depth == 0) {
+                    break;
+                }
+            }
+            if (i >= head.size())
+                return {};
+            ++i;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    int end = ++i;
+    while (end < head.size() && !QChar::isSpace(static_cast<uchar>(head[end])) && head[end] != '>' && head[end] != '/')
+        ++end;
+
+    const QByteArray name = head.mid(i, end - i);
+    return name.mid(name.lastIndexOf(':') + 1);
+}
@@ -0,0 +1,108 @@
+#ifndef GPX_TRACKREADER_H
+#define GPX_TRACKREADER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <memory>
+
+#include "decompressor.h"
+#include "statistic.h"
+#include "track.h"
+
+class QFile;
+
+namespace GPX
+{
+
+/// The content of a track file as the readers get it: decompressed if needed, mapped
+/// into memory if it is plain, with the progress counted in bytes of the file
+class Input
+{
+public:
+    /// \a progress gets the bytes of the file consumed and returns false to stop reading;
+    /// \a cancelled is the same check without reporting, for any thread
+    Input(QFile* file, Decompressor::Format format,
+          const std::function<bool(qint64)>& progress, const std::function<bool()>& cancelled);
+    ~Input();
+
+    /// (re)starts the content from the beginning
+    bool open();
+    QString errorString() const { return mErrorString; }
+    /// the decompression failed, whatever the reader says
+    bool hasFailed() const { return mDecompressor && mDecompressor->hasFailed(); }
+
+    QIODevice* device() const { return mDevice; }
+    bool isCompressed() const { return mFormat != Decompressor::Plain; }
+
+    /// the beginning of the content, to tell the format by
+    QByteArray head() const;
+
+    /// the whole content of a plain file, nullptr if it is compressed or cannot be mapped
+    const char* map();
+    /// of the file, which the progress is counted in
+    qint64 size() const;
+    qint64 pos() const;
+
+    /// reports pos()
+    bool progress() { return progress(pos()); }
+    bool progress(qint64 consumed) { return !mProgress || mProgress(consumed); }
+    bool isCancelled() const { return mCancelled && mCancelled(); }
+
+    /// see Loader::setChunkSize()
+    qint64 chunkSize() const { return mChunkSize; }
+    void setChunkSize(qint64 bytes) { mChunkSize = bytes; }
+
+private:
+    QFile* mFile;
+    Decompressor::Format mFormat;
+    std::function<bool(qint64)> mProgress;
+    std::function<bool()> mCancelled;
+
+    std::unique_ptr<Decompressor> mDecompressor;
+    QIODevice* mDevice = nullptr;
+    uchar* mMapped = nullptr;
+    qint64 mChunkSize = 0;
+    QString mErrorString;
+};
+
+/// Reads one track format into the common representation. The format of a file is told
+/// by its content: create() asks the formats in the order they were added, and only if
+/// none of them is sure, it goes by the file name.
+class Reader
+{
+public:
+    virtual ~Reader() {}
+
+    /// e.g. "GPX", for messages
+    virtual QString format() const = 0;
+    virtual QStringList nameFilters() const = 0;
+    virtual bool canRead(const QByteArray& head) const = 0;
+
+    /// appends to \a track, \a statistic and \a name, which are empty at first
+    /// \return false with \a error set, "Cancelled" if Input::progress() said so
+    virtual bool read(Input* input, TrackStore* track, Statistic* statistic, QString* name, QString* error) = 0;
+
+    typedef std::function<Reader*()> Factory;
+
+    /// makes another format known, before anything is loaded; the built-in ones come first
+    static void add(const Factory& factory);
+    /// \a fileName is the hint for the content none of the formats recognizes,
+    /// e.g. a GPX with a comment longer than the head
+    static std::unique_ptr<Reader> create(const QByteArray& head, const QString& fileName = QString());
+    /// of every format, plain and compressed
+    static QStringList allNameFilters();
+
+protected:
+    /// the local name of the root element, if \a head is the beginning of an XML document
+    /// in any Unicode encoding; empty if it is not or the root is beyond \a head
+    static QByteArray xmlRoot(const QByteArray& head);
+    /// the ASCII characters of \a head decoded from UTF-8, UTF-16 or UTF-32, the others are '?'
+    static QByteArray ascii(const QByteArray& head);
+};
+
+} // namespace GPX
+
+#endif // GPX_TRACKREADER_H
@@ -0,0 +1,75 @@
+#include "jobpanel.h"
+
+#include <QApplication>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QPushButton>
+#include <QStyle>
+#include <QStyleOption>
+#include <QStyledItemDelegate>
+#include <QTableView>
+#include <QVBoxLayout>
+
+#include "jobs.h"
+
+class ProgressDelegate : public QStyledItemDelegate
+{
+public:
+    using QStyledItemDelegate::QStyledItemDelegate;
+
+    void paint(QPainter* painter, const QStyleOptionViewItem& option, const QModelIndex& index) const override {
+        if (index.data(Jobs::Role::State).toInt() != Jobs::Running)
+            return QStyledItemDelegate::paint(painter, option, index);
+
+        QStyleOptionProgressBar bar;
+        bar.rect = option.rect.adjusted(1, 1, -1, -1);
+        bar.minimum = 0;
+        bar.maximum = 100;
+        bar.progress = index.data(Jobs::Role::Percent).toInt();
+        bar.text = index.data().toString();
+        bar.textVisible = true;
+        QApplication::style()->drawControl(QStyle::CE_ProgressBar, &bar, painter);
+    }
+};
+
+JobPanel::JobPanel(Jobs* jobs, QWidget* parent) :
+    QWidget(parent),
+    mJobs(jobs),
+    mView(new QTableView),
+    mCancel(new QPushButton(tr("Cancel"))),
+    mCancelAll(new QPushButton(tr("Cancel all")))
+{
+    mView->setModel(mJobs);
+    mView->setItemDelegateForColumn(Jobs::Column::Progress, new ProgressDelegate(this));
+    mView->setSelectionBehavior(QAbstractItemView::SelectRows);
+    mView->setSelectionMode(QAbstractItemView::SingleSelection);
+    mView->verticalHeader()->hide();
+    mView->horizontalHeader()->setSectionResizeMode(Jobs::Column::Title, QHeaderView::Stretch);
+
+    auto buttons = new QHBoxLayout;
+    buttons->addStretch();
+    buttons->addWidget(mCancel);
+    buttons->addWidget(mCancelAll);
+
+    auto layout = new QVBoxLayout(this);
+    layout->addWidget(mView);
+    layout->addLayout(buttons);
+
+    connect(mCancel, &QPushButton::clicked, this, [this]{
+        const QModelIndexList rows = mView->selectionModel()->selectedRows();
+        if (!rows.isEmpty())
+            mJobs->cancel(rows.first().row());
+    });
+    connect(mCancelAll, &QPushButton::clicked, mJobs, &Jobs::cancelAll);
+
+    connect(mView->selectionModel(), &QItemSelectionModel::selectionChanged, this, &JobPanel::updateButtons);
+    connect(mJobs, &Jobs::rowsInserted, this, &JobPanel::updateButtons);
+    connect(mJobs, &Jobs::rowsRemoved, this, &JobPanel::updateButtons);
+    updateButtons();
+}
+
+void JobPanel::updateButtons()
+{
+    mCancel->setEnabled(mView->selectionModel()->hasSelection());
+    mCancelAll->setEnabled(mJobs->rowCount() > 0);
+}
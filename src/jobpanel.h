@@ -0,0 +1,31 @@
+#ifndef JOBPANEL_H
+#define JOBPANEL_H
+
+#include <QWidget>
+
+QT_BEGIN_NAMESPACE
+class QPushButton;
+class QTableView;
+QT_END_NAMESPACE
+
+class Jobs;
+
+/* The list of the running and the queued jobs with the buttons to cancel them */
+
+class JobPanel : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit JobPanel(Jobs* jobs, QWidget* parent = nullptr);
+
+private:
+    void updateButtons();
+
+    Jobs* mJobs;
+    QTableView* mView;
+    QPushButton* mCancel;
+    QPushButton* mCancelAll;
+};
+
+#endif // JOBPANEL_H
@@ -0,0 +1,239 @@
+#include "jobs.h"
+
+#include <QDebug>
+#include <QTime>
+
+#include <algorithm>
+
+namespace
+{
+
+const qint64 EstimateAfter = 1000; // ms, the first moments say little about the rate
+const qint64 UpdateInterval = 250; // ms, workers report far more often than that
+
+} // namespace
+
+Jobs::Jobs(QObject* parent) : QAbstractTableModel(parent)
+{
+}
+
+/// a linear estimate, -1 if it's too early to tell
+qint64 Jobs::Job::msecsLeft() const
+{
+    if (state != Running || current <= 0 || total <= 0 || timer.elapsed() < EstimateAfter)
+        return -1;
+    return timer.elapsed() * (total - current) / current;
+}
+
+int Jobs::append(const QString& title, Priority priority, const QObject* worker,
+                 std::function<void()> start, std::function<void()> cancel)
+{
+    Job job;
+    job.id = ++mLastId;
+    job.title = title;
+    job.priority = priority;
+    job.worker = worker;
+    job.start = start;
+    job.cancel = cancel;
+
+    const bool wasBusy = isBusy();
+    beginInsertRows({}, mJobs.size(), mJobs.size());
+    mJobs.append(job);
+    endInsertRows();
+
+    if (!wasBusy)
+        emit busyChanged(true);
+    return job.id;
+}
+
+/// a queued job is started and cancelled at once, so its worker finishes the usual way
+void Jobs::cancel(int row)
+{
+    if (row < 0 || row >= mJobs.size() || mJobs[row].state == Cancelling)
+        return;
+
+    const int id = mJobs[row].id;
+    if (mJobs[row].state == Queued)
+        start(id);
+
+    row = rowOf(id);
+    if (row < 0)
+        return; // finished already
+
+    Job& job = mJobs[row];
+    job.state = Cancelling;
+    qInfo() << "Jobs: cancelling" << job.title;
+    job.cancel();
+    emit dataChanged(index(row, 0), index(row, Column::Count - 1));
+}
+
+void Jobs::cancel(const QObject* worker)
+{
+    auto i = std::find_if(mJobs.cbegin(), mJobs.cend(), [worker](const Job& job) { return job.worker == worker; });
+    if (i != mJobs.cend())
+        cancel(static_cast<int>(i - mJobs.cbegin()));
+}
+
+void Jobs::cancelAll()
+{
+    // the rows stay until the workers finish
+    for (int row = mJobs.size() - 1; row >= 0; --row)
+        cancel(row);
+}
+
+void Jobs::setProgress(int id, qint64 current, qint64 total)
+{
+    const int row = rowOf(id);
+    if (row < 0)
+        return;
+
+    Job& job = mJobs[row];
+    const int percent = job.percent();
+    job.current = current;
+    job.total = total;
+    if (job.percent() == percent && job.updated.isValid() && job.updated.elapsed() < UpdateInterval)
+        return;
+    job.updated.start();
+
+    emit dataChanged(index(row, Column::Progress), index(row, Column::TimeLeft));
+    updateProgress();
+}
+
+void Jobs::finish(int id)
+{
+    const int row = rowOf(id);
+    if (row < 0)
+        return;
+
+    qInfo() << "Jobs:" << mJobs[row].title << "finished in" << mJobs[row].timer.elapsed() << "ms";
+
+    beginRemoveRows({}, row, row);
+    mJobs.removeAt(row);
+    endRemoveRows();
+
+    schedule();
+    updateProgress();
+    if (!isBusy())
+        emit busyChanged(false);
+}
+
+/// starts the interactive jobs and the next one of the others, if none of them is running
+void Jobs::schedule()
+{
+    bool running = false;
+    for (const Job& job: qAsConst(mJobs))
+        running |= job.priority != Interactive && job.state != Queued;
+
+    QList<int> started; // ids, the rows may change while starting
+    const Job* next = nullptr;
+    for (const Job& job: qAsConst(mJobs))
+    {
+        if (job.state != Queued)
+            continue;
+        if (job.priority == Interactive)
+            started.append(job.id);
+        else if (!running && (!next || job.priority > next->priority))
+            next = &job;
+    }
+    if (next)
+        started.append(next->id);
+
+    for (int id: started)
+        start(id);
+}
+
+void Jobs::start(int id)
+{
+    const int row = rowOf(id);
+    if (row < 0 || mJobs[row].state != Queued)
+        return;
+
+    Job& job = mJobs[row];
+    job.state = Running;
+    job.timer.start();
+    emit dataChanged(index(row, 0), index(row, Column::Count - 1));
+
+    qInfo() << "Jobs: starting" << job.title;
+    const std::function<void()> start = job.start; // may finish the job synchronously
+    start();
+}
+
+void Jobs::updateProgress()
+{
+    int sum = 0, count = 0;
+    for (const Job& job: qAsConst(mJobs)) {
+        if (job.state != Queued) {
+            sum += job.percent();
+            ++count;
+        }
+    }
+    emit progress(count ? sum / count : 0);
+}
+
+int Jobs::rowOf(int id) const
+{
+    auto i = std::find_if(mJobs.cbegin(), mJobs.cend(), [id](const Job& job) { return job.id == id; });
+    return i == mJobs.cend() ? -1 : static_cast<int>(i - mJobs.cbegin());
+}
+
+int Jobs::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : mJobs.size();
+}
+
+int Jobs::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : Column::Count;
+}
+
+QVariant Jobs::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= mJobs.size())
+        return {};
+
+    const Job& job = mJobs[index.row()];
+
+    if (role == Role::Percent)
+        return job.percent();
+    if (role == Role::State)
+        return job.state;
+    if (role != Qt::DisplayRole)
+        return {};
+
+    switch (index.column())
+    {
+    case Column::Title:
+        return job.title;
+    case Column::Progress:
+        switch (job.state) {
+        case Queued: return tr("Queued");
+        case Cancelling: return tr("Cancelling");
+        case Running: return tr("%1%").arg(job.percent());
+        }
+        break;
+    case Column::TimeLeft: {
+        const qint64 left = job.msecsLeft();
+        if (left < 0)
+            return {};
+        return QTime(0, 0).addMSecs(static_cast<int>(std::min<qint64>(left, 24 * 60 * 60 * 1000 - 1)))
+                .toString(left < 60 * 60 * 1000 ? "m:ss" : "h:mm:ss");
+    }
+    }
+
+    return {};
+}
+
+QVariant Jobs::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole || orientation != Qt::Horizontal)
+        return {};
+
+    switch (section)
+    {
+    case Column::Title: return tr("Job");
+    case Column::Progress: return tr("Progress");
+    case Column::TimeLeft: return tr("Time left");
+    }
+
+    return {};
+}
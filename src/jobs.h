@@ -0,0 +1,89 @@
+#ifndef JOBS_H
+#define JOBS_H
+
+#include <QAbstractTableModel>
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+
+#include <functional>
+
+/* The long operations of the window: loading tracks and photos, saving EXIF.
+   A job is a worker object with the usual start / cancel() / progress() / finished() interface.
+   Interactive jobs start at once, so a track is never loaded after the thumbnails;
+   the others run one at a time, the higher priority first, then in order.
+   The model lists the queued and the running jobs with their progress and the time left. */
+
+class Jobs : public QAbstractTableModel
+{
+    Q_OBJECT
+
+signals:
+    void busyChanged(bool busy);
+    void progress(int percent); // of all the running jobs
+
+public:
+    enum Priority { Background, Normal, Interactive };
+    enum State { Queued, Running, Cancelling };
+    struct Column { enum { Title, Progress, TimeLeft, Count }; };
+    struct Role { enum { Percent = Qt::UserRole, State }; };
+
+    explicit Jobs(QObject* parent = nullptr);
+
+    /// queues \a worker to be started with \a start; it must emit finished() in any case, cancelled or not
+    template <class Worker>
+    int add(const QString& title, Priority priority, Worker* worker, std::function<void()> start);
+
+    void cancel(int row);
+    void cancel(const QObject* worker);
+    void cancelAll();
+    bool isBusy() const { return !mJobs.isEmpty(); }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Job
+    {
+        int id = 0;
+        QString title;
+        Priority priority = Normal;
+        const QObject* worker = nullptr;
+        State state = Queued;
+        qint64 current = 0;
+        qint64 total = 0;
+        QElapsedTimer timer; // since started
+        QElapsedTimer updated; // since shown last time
+        std::function<void()> start;
+        std::function<void()> cancel;
+
+        int percent() const { return total > 0 ? static_cast<int>(100 * current / total) : 0; }
+        qint64 msecsLeft() const;
+    };
+
+    int append(const QString& title, Priority priority, const QObject* worker,
+               std::function<void()> start, std::function<void()> cancel);
+    void setProgress(int id, qint64 current, qint64 total);
+    void finish(int id);
+    void schedule();
+    void start(int id);
+    void updateProgress();
+    int rowOf(int id) const;
+
+    QList<Job> mJobs; // queued and running
+    int mLastId = 0;
+};
+
+template <class Worker>
+int Jobs::add(const QString& title, Priority priority, Worker* worker, std::function<void()> start)
+{
+    const int id = append(title, priority, worker, start, [worker]{ worker->cancel(); });
+    connect(worker, &Worker::progress, this, [this, id](qint64 current, qint64 total){ setProgress(id, current, total); });
+    connect(worker, &Worker::finished, this, [this, id]{ finish(id); });
+    schedule();
+    return id;
+}
+
+#endif // JOBS_H
@@ -0,0 +1,274 @@
+#include "cache.h"
+
+#include <QAtomicPointer>
+#include <QDataStream>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+const quint32 Magic = 0x67746368; // "gtch"
+const quint32 Version = 3;
+
+// a save rewrites the whole file, so it waits for this many new entries...
+const int SaveThreshold = 1000;
+// ...or this long, msecs
+const qint64 SaveInterval = 10 * 60 * 1000;
+
+QAtomicPointer<jpeg::Cache> gInstance;
+
+// thumbnails are tiny, raw pixels are faster to restore than any image format
+
+void writeImage(QDataStream& stream, const QImage& image)
+{
+    const QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+    stream << rgb.width() << rgb.height();
+    for (int y = 0; y < rgb.height(); ++y)
+        stream.writeRawData(reinterpret_cast<const char*>(rgb.constScanLine(y)), rgb.width() * 3);
+}
+
+void readImage(QDataStream& stream, QImage* image)
+{
+    int width = 0, height = 0;
+    stream >> width >> height;
+    if (width <= 0 || height <= 0 || width > 256 || height > 256) {
+        *image = {};
+        return;
+    }
+
+    *image = QImage(width, height, QImage::Format_RGB888);
+    for (int y = 0; y < height; ++y)
+        stream.readRawData(reinterpret_cast<char*>(image->scanLine(y)), width * 3);
+}
+
+} // namespace
+
+namespace jpeg
+{
+
+QDataStream& operator<<(QDataStream& stream, const Cache::Entry& entry)
+{
+    const Photo& photo = entry.photo;
+    const quint8 flags = (photo.flags.haveShotTime ? 1 : 0) | (photo.flags.haveGPSCoord ? 2 : 0);
+    stream << entry.size << entry.modified << entry.used
+           << photo.path << photo.name << photo.time << photo.position << photo.altitude << flags;
+    writeImage(stream, photo.thumbnail);
+    return stream;
+}
+
+QDataStream& operator>>(QDataStream& stream, Cache::Entry& entry)
+{
+    Photo& photo = entry.photo;
+    quint8 flags = 0;
+    stream >> entry.size >> entry.modified >> entry.used
+           >> photo.path >> photo.name >> photo.time >> photo.position >> photo.altitude >> flags;
+    readImage(stream, &photo.thumbnail);
+    photo.flags.haveShotTime = (flags & 1) != 0;
+    photo.flags.haveGPSCoord = (flags & 2) != 0;
+    return stream;
+}
+
+} // namespace jpeg
+
+jpeg::Cache::Cache(const QString& fileName) : mFileName(fileName)
+{
+    mSinceSave.start();
+}
+
+/// the application-wide cache, loaded on the first use
+jpeg::Cache& jpeg::Cache::instance()
+{
+    static Cache* cache = [] {
+        Cache* cache = new Cache(defaultFileName()); // intentionally leaked, may be used by pool threads on exit
+        cache->load();
+        gInstance.storeRelease(cache);
+        return cache;
+    }();
+    return *cache;
+}
+
+bool jpeg::Cache::saveInstance()
+{
+    Cache* cache = gInstance.loadAcquire();
+    return !cache || cache->save();
+}
+
+QString jpeg::Cache::defaultFileName()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).absoluteFilePath("photos.cache");
+}
+
+bool jpeg::Cache::find(const QFileInfo& file, Photo* photo)
+{
+    // a write lock for the time of use, the lookup is short anyway
+    QWriteLocker lock(&mLock);
+
+    auto i = mEntries.find(file.absoluteFilePath());
+    if (i == mEntries.end())
+        return false;
+
+    // the file changed since, the entry is of no use anymore
+    if (i->size != file.size() || i->modified != file.lastModified().toMSecsSinceEpoch()) {
+        mEntries.erase(i);
+        ++mUnsaved;
+        return false;
+    }
+
+    i->used = QDateTime::currentMSecsSinceEpoch();
+
+    *photo = i->photo;
+    photo->fileSize = i->size;
+    photo->fileModified = i->modified;
+    return true;
+}
+
+void jpeg::Cache::insert(const QFileInfo& file, const Photo& photo)
+{
+    Entry entry;
+    entry.size = file.size();
+    entry.modified = file.lastModified().toMSecsSinceEpoch();
+    entry.used = QDateTime::currentMSecsSinceEpoch();
+    entry.photo = photo;
+    entry.photo.flags.coordGuessed = false; // not a property of the file
+
+    QWriteLocker lock(&mLock);
+    mEntries.insert(file.absoluteFilePath(), entry);
+    ++mUnsaved;
+}
+
+bool jpeg::Cache::load()
+{
+    QFile file(mFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_6);
+
+    quint32 magic = 0, version = 0;
+    stream >> magic >> version;
+    if (magic != Magic || version != Version) {
+        qInfo() << "jpeg::Cache:" << mFileName << "is outdated, ignored";
+        return false;
+    }
+
+    QHash<QString, Entry> entries;
+    quint32 count = 0;
+    stream >> count;
+    entries.reserve(static_cast<int>(count));
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+    {
+        Entry entry;
+        stream >> entry;
+        entries.insert(entry.photo.path, entry);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "jpeg::Cache:" << mFileName << "is corrupted, ignored";
+        return false;
+    }
+
+    QWriteLocker lock(&mLock);
+    mEntries.swap(entries);
+    mUnsaved = 0;
+    mSinceSave.restart();
+    qInfo() << "jpeg::Cache:" << mEntries.size() << "photo(s) loaded from" << mFileName;
+    return true;
+}
+
+/// drops the least recently used entries above the capacity;
+/// the files are not looked at, that would stall on a slow or unplugged drive
+void jpeg::Cache::prune(QHash<QString, Entry>* entries) const
+{
+    if (entries->size() <= mCapacity)
+        return;
+
+    std::vector<qint64> used;
+    used.reserve(entries->size());
+    for (const Entry& entry: qAsConst(*entries))
+        used.push_back(entry.used);
+    // the entries used at this time or later stay
+    auto oldest = used.end() - mCapacity;
+    std::nth_element(used.begin(), oldest, used.end());
+    const qint64 threshold = *oldest;
+
+    for (auto i = entries->begin(); i != entries->end() && entries->size() > mCapacity; )
+    {
+        if (i->used < threshold)
+            i = entries->erase(i);
+        else
+            ++i;
+    }
+}
+
+/// writes the cache if anything was inserted or dropped since the last save
+bool jpeg::Cache::save()
+{
+    QMutexLocker saving(&mSaveMutex);
+
+    QHash<QString, Entry> entries;
+    int unsaved = 0;
+    const qint64 started = QDateTime::currentMSecsSinceEpoch();
+    {
+        QWriteLocker lock(&mLock);
+        if (mUnsaved == 0)
+            return true;
+        entries = mEntries; // implicitly shared, inserts won't wait for the disk
+        unsaved = mUnsaved;
+        mUnsaved = 0;
+        mSinceSave.restart();
+    }
+
+    const int total = entries.size();
+    prune(&entries);
+    if (entries.size() != total)
+    {
+        // the dropped ones go from memory too, unless they were found or inserted meanwhile
+        QWriteLocker lock(&mLock);
+        for (auto i = mEntries.begin(); i != mEntries.end(); )
+        {
+            if (i->used < started && !entries.contains(i.key()))
+                i = mEntries.erase(i);
+            else
+                ++i;
+        }
+    }
+
+    QDir().mkpath(QFileInfo(mFileName).absolutePath());
+
+    QSaveFile file(mFileName);
+    if (file.open(QIODevice::WriteOnly))
+    {
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_5_6);
+        stream << Magic << Version << static_cast<quint32>(entries.size());
+        for (const Entry& entry: qAsConst(entries))
+            stream << entry;
+
+        if (file.commit())
+            return true;
+    }
+
+    qWarning() << "jpeg::Cache: unable to write" << mFileName << file.errorString();
+    QWriteLocker lock(&mLock);
+    mUnsaved += unsaved; // try again next time
+    return false;
+}
+
+bool jpeg::Cache::saveIfDue()
+{
+    {
+        QReadLocker lock(&mLock);
+        if (mUnsaved < SaveThreshold && (mUnsaved == 0 || mSinceSave.elapsed() < SaveInterval))
+            return true;
+    }
+    return save();
+}
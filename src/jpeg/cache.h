@@ -0,0 +1,75 @@
+#ifndef JPEG_CACHE_H
+#define JPEG_CACHE_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QReadWriteLock>
+#include <QString>
+
+#include "photo.h"
+
+class QDataStream;
+class QFileInfo;
+
+namespace jpeg
+{
+
+/// Loaded photos with their thumbnails kept between the runs.
+/// An entry is keyed by the file path and is valid while the file size and modification time
+/// stay the same, so a file changed by anyone (including jpeg::Saver) is simply loaded again.
+/// An entry found stale by find() is dropped then; the entries of the files that are gone stay
+/// until they are the least recently used ones above capacity(), so those of an unplugged drive
+/// are still there when it is back.
+/// The file is rewritten as a whole, so it is saved only once enough has changed (see saveIfDue())
+/// and on exit. All the functions are thread-safe.
+class Cache
+{
+public:
+    explicit Cache(const QString& fileName);
+
+    static Cache& instance();
+    static QString defaultFileName();
+    /// saves instance() if it was ever used, e.g. on exit
+    static bool saveInstance();
+
+    static const int DefaultCapacity = 20000;
+
+    /// the most entries kept when saving, about 3 KB each
+    void setCapacity(int entries) { mCapacity = entries; }
+    int capacity() const { return mCapacity; }
+
+    bool find(const QFileInfo& file, Photo* photo);
+    void insert(const QFileInfo& file, const Photo& photo);
+
+    bool load();
+    bool save();
+    /// saves if many entries were inserted or some of them long ago
+    bool saveIfDue();
+
+private:
+    struct Entry
+    {
+        qint64 size = 0;
+        qint64 modified = 0; // msecs since epoch
+        qint64 used = 0; // msecs since epoch, of the last find() or insert()
+        Photo photo;
+    };
+
+    void prune(QHash<QString, Entry>* entries) const;
+
+    friend QDataStream& operator<<(QDataStream& stream, const Entry& entry);
+    friend QDataStream& operator>>(QDataStream& stream, Entry& entry);
+
+    const QString mFileName;
+    QHash<QString, Entry> mEntries;
+    int mUnsaved = 0; // entries inserted or dropped since the last save
+    QElapsedTimer mSinceSave;
+    int mCapacity = DefaultCapacity;
+    mutable QReadWriteLock mLock;
+    QMutex mSaveMutex;
+};
+
+} // namespace jpeg
+
+#endif // JPEG_CACHE_H
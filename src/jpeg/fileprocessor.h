@@ -0,0 +1,25 @@
+#ifndef JPEG_FILEPROCESSOR_H
+#define JPEG_FILEPROCESSOR_H
+
+#include <QObject>
+#include <QStringList>
+
+namespace jpeg
+{
+
+class FileProcessor : public QObject
+{
+    Q_OBJECT
+
+signals:
+    void progress(int i, int total);
+
+public:
+    using QObject::QObject;
+
+    QStringList errors;
+};
+
+} // namespace jpeg
+
+#endif // JPEG_FILEPROCESSOR_H
@@ -0,0 +1,67 @@
+#include "journal.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFileInfo>
+#include <QMutexLocker>
+#include <QStandardPaths>
+
+jpeg::Journal::Journal(const QString& fileName) : mFile(fileName)
+{
+}
+
+QString jpeg::Journal::defaultFileName()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("save.journal");
+}
+
+QByteArray jpeg::Journal::entry(const QString& path, const QByteArray& values)
+{
+    return QCryptographicHash::hash(values, QCryptographicHash::Sha1).toHex() + ' ' + path.toUtf8();
+}
+
+bool jpeg::Journal::open()
+{
+    mDone.clear();
+    mFile.close();
+
+    if (mFile.open(QIODevice::ReadOnly))
+    {
+        QByteArray last;
+        while (!mFile.atEnd())
+        {
+            const QByteArray line = mFile.readLine();
+            // a line without the newline was cut by the crash and can't be trusted
+            if (line.endsWith('\n'))
+                mDone.insert(line.chopped(1));
+            else
+                last = line;
+        }
+        mFile.close();
+
+        if (!mDone.isEmpty())
+            qInfo() << "jpeg::Journal:" << mDone.size() << "file(s) already saved, resuming";
+
+        // the cut line is dropped, or the next entry would be appended to it
+        if (!last.isEmpty() && !mFile.resize(mFile.size() - last.size()))
+            return false;
+    }
+
+    QDir().mkpath(QFileInfo(mFile).absolutePath());
+    return mFile.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+/// records \a path as written with \a values, can be called from any thread
+bool jpeg::Journal::commit(const QString& path, const QByteArray& values)
+{
+    QMutexLocker lock(&mMutex);
+    return mFile.write(entry(path, values) + '\n') > 0 && mFile.flush();
+}
+
+void jpeg::Journal::remove()
+{
+    QMutexLocker lock(&mMutex);
+    mFile.remove();
+    mDone.clear();
+}
@@ -0,0 +1,45 @@
+#ifndef JPEG_JOURNAL_H
+#define JPEG_JOURNAL_H
+
+#include <QByteArray>
+#include <QFile>
+#include <QMutex>
+#include <QSet>
+#include <QString>
+
+namespace jpeg
+{
+
+/// Remembers the files already written by a save, so a save interrupted by a crash or a cancel
+/// resumes where it stopped instead of writing (and shifting the time of) the files twice.
+/// An entry is the path with the values written to it, whatever batch they were saved in,
+/// so a file to be written with other values is written again.
+/// The file holds a line per written file: the hash of the values, a space and the path.
+class Journal
+{
+public:
+    explicit Journal(const QString& fileName);
+
+    /// continues the journal left by the saves before
+    bool open();
+    bool contains(const QString& path, const QByteArray& values) const { return mDone.contains(entry(path, values)); }
+    bool commit(const QString& path, const QByteArray& values);
+    /// all is saved, nothing to resume
+    void remove();
+
+    int resumed() const { return mDone.size(); }
+    QString errorString() const { return mFile.errorString(); }
+
+    static QString defaultFileName();
+
+private:
+    static QByteArray entry(const QString& path, const QByteArray& values);
+
+    QFile mFile;
+    QSet<QByteArray> mDone; // read from the previous runs, not modified while saving
+    QMutex mMutex;
+};
+
+} // namespace jpeg
+
+#endif // JPEG_JOURNAL_H
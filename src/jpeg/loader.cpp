@@ -0,0 +1,301 @@
+#include "loader.h"
+
+#include <QBuffer>
+#include <QDebug>
+#include <QEventLoop>
+#include <QFileInfo>
+#include <QImage>
+#include <QImageReader>
+#include <QThread>
+
+#include "exif/utils.h"
+#include "task.h"
+
+#include "cache.h"
+
+namespace Pics
+{
+
+// QPixmap is not allowed outside the GUI thread, so QImage is used here
+
+QImage thumbnail(QImageReader* reader, int width, int height)
+{
+    if (width == 0 || height == 0)
+        return reader->read();
+
+    QSize size = reader->size();
+    if (size.isEmpty())
+        return reader->read();
+
+    double dw = 1.0 * width / size.width();
+    double dh = 1.0 * height / size.height();
+    QSize cropped_size = size * std::max(dw, dh);
+
+    // libjpeg can decode at 1/2, 1/4 or 1/8 of the size at a fraction of the cost (DCT scaling);
+    // Qt's JPEG plugin does so for a scaled size and a quality below 50, the rest is scaled here
+    int denominator = 8;
+    while (denominator > 1 && (size.width() / denominator < cropped_size.width() ||
+                               size.height() / denominator < cropped_size.height()))
+        denominator /= 2;
+
+    if (denominator > 1)
+    {
+        reader->setQuality(49);
+        reader->setScaledSize(QSize(size.width() / denominator, size.height() / denominator));
+        const QImage decoded = reader->read();
+        if (decoded.isNull())
+            return decoded;
+        return decoded.scaled(cropped_size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation)
+                      .copy((cropped_size.width() - width) / 2, (cropped_size.height() - height) / 2, width, height);
+    }
+
+    reader->setScaledSize(cropped_size);
+    reader->setScaledClipRect(QRect((cropped_size.width() - width) / 2,
+                                    (cropped_size.height() - height) / 2,
+                                    width,
+                                    height));
+    return reader->read();
+}
+
+} // namespace Pics
+
+
+namespace
+{
+
+constexpr int BatchSize = 256;
+constexpr int BatchInterval = 100; // ms
+
+} // namespace
+
+
+jpeg::Loader::Loader(QObject* parent) : FileProcessor(parent)
+{
+    // file reading is latency-bound, keep more requests in flight than there are cores
+    mReadPool.setMaxThreadCount(QThread::idealThreadCount() * 2);
+    mThumbnailPool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+jpeg::Loader::~Loader()
+{
+    cancel();
+    // the first stage starts the second one, so wait in this order
+    mReadPool.waitForDone();
+    mThumbnailPool.waitForDone();
+}
+
+void jpeg::Loader::start(const QStringList& fileNames)
+{
+    Q_ASSERT(!isRunning());
+
+    errors.clear();
+    statistic.clear();
+
+    mItems = QVector<Item>(fileNames.size());
+    mDone = QVector<bool>(fileNames.size(), false);
+    mDoneCount = 0;
+    mDelivered = 0;
+    mCancelled.storeRelease(0);
+    mSinceDelivery.start();
+
+    if (mItems.isEmpty()) {
+        QMetaObject::invokeMethod(this, &Loader::finished, Qt::QueuedConnection);
+        return;
+    }
+
+    emit progress(0, mItems.size());
+
+    for (int i = 0; i < mItems.size(); ++i)
+    {
+        mItems[i].path = fileNames[i];
+        run(&mReadPool, [this, i]{ read(i); });
+    }
+}
+
+void jpeg::Loader::cancel()
+{
+    // queued files are skipped quickly, finished() is emitted as usual
+    mCancelled.storeRelease(1);
+}
+
+bool jpeg::Loader::load(const QStringList& fileNames)
+{
+    loaded.clear();
+
+    QEventLoop loop;
+    connect(this, &Loader::batchLoaded, &loop, [this](const QList<Photo>& batch){ loaded.append(batch); });
+    connect(this, &Loader::finished, &loop, &QEventLoop::quit);
+    start(fileNames);
+    loop.exec();
+
+    return errors.isEmpty() && !isCancelled();
+}
+
+/// the first stage: stat, read APP1 and decode the GPS and time tags
+void jpeg::Loader::read(int i)
+{
+    Item& item = mItems[i];
+
+    if (isCancelled())
+        return done(i);
+
+    QFileInfo& file = item.file;
+    file.setFile(item.path);
+    if (!file.exists())
+    {
+        item.error = tr("Unable to add '%1': no such file").arg(file.absoluteFilePath());
+        return done(i);
+    }
+
+    Photo& photo = item.photo;
+    if (mThumbnails && Cache::instance().find(file, &photo))
+        return done(i);
+
+    photo.path = file.absoluteFilePath();
+    photo.name = file.baseName();
+    photo.time = file.lastModified();
+    photo.fileSize = file.size();
+    photo.fileModified = photo.time.toMSecsSinceEpoch();
+
+    Exif::Reader& exif = item.exif; // kept for the thumbnail
+    if (!exif.load(file.absoluteFilePath()))
+    {
+        item.error = tr("Unable to read EXIF from '%1'").arg(file.absoluteFilePath());
+        photo = {};
+        return done(i);
+    }
+
+    {
+        auto lat = exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE);
+        auto lon = exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE);
+        auto alt = exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE);
+        auto latRef = exif.ascii(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE_REF);
+        auto lonRef = exif.ascii(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE_REF);
+        auto altRef = exif.ascii(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE_REF);
+
+        if (!lat.isEmpty() && !lon.isEmpty())
+        {
+            photo.setPosition(Exif::Utils::fromLatLon(lat, latRef, lon, lonRef));
+            if (!alt.isEmpty())
+            {
+                photo.altitude = Exif::Utils::fromSingleRational(alt, altRef);
+            }
+
+            photo.flags.haveGPSCoord = true;
+        }
+    }
+
+    {
+        QByteArray timeString = exif.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZED);
+        if (timeString.isEmpty())
+            timeString = exif.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL);
+        // we can also check EXIF_TAG_DATE_TIME in EXIF_IFD_0,
+        // however this one may be the file editing / raw export time
+        QString pattern = "yyyy:MM:dd hh:mm:ss";
+        if (timeString.size() == pattern.size())
+        {
+            QDateTime time = QDateTime::fromString(QString::fromLatin1(timeString), pattern);
+            if (time.isValid())
+            {
+                photo.time = time;
+                photo.flags.haveShotTime = true;
+            }
+        }
+    }
+
+    if (!mThumbnails)
+    {
+        exif = {};
+        return done(i);
+    }
+
+    run(&mThumbnailPool, [this, i]{ makeThumbnail(i); });
+}
+
+/// the second stage: decode and scale the thumbnail
+void jpeg::Loader::makeThumbnail(int i)
+{
+    Item& item = mItems[i];
+
+    if (isCancelled())
+    {
+        item = {};
+        return done(i);
+    }
+
+    // the embedded one is sliced out of the segment read by the first stage,
+    // the image itself is decoded only if there is none
+    QByteArray thumbnail = item.exif.thumbnail(); // not copied
+    QImage pix;
+    if (thumbnail.size())
+    {
+        QBuffer buffer(&thumbnail);
+        QImageReader reader(&buffer);
+        pix = Pics::thumbnail(&reader, 32, 32);
+    }
+
+    if (pix.isNull())
+    {
+        QImageReader reader(item.photo.path);
+        pix = Pics::thumbnail(&reader, 32, 32);
+    }
+
+    item.photo.thumbnail = pix;
+    item.exif = {};
+    Cache::instance().insert(item.file, item.photo);
+    done(i);
+}
+
+void jpeg::Loader::done(int i)
+{
+    QMetaObject::invokeMethod(this, [this, i]{ onDone(i); }, Qt::QueuedConnection);
+}
+
+/// collects the finished files in the owner thread and delivers the ready ones in order
+void jpeg::Loader::onDone(int i)
+{
+    mDone[i] = true;
+    emit progress(++mDoneCount, mItems.size());
+
+    int ready = mDelivered;
+    while (ready < mItems.size() && mDone[ready])
+        ++ready;
+
+    const bool last = ready == mItems.size();
+    if (ready == mDelivered)
+        return;
+    if (!last && ready - mDelivered < BatchSize && mSinceDelivery.elapsed() < BatchInterval)
+        return;
+
+    // once cancelled, the files that finished before are dropped as well:
+    // the receiver may have been cleared already
+    const bool cancelled = isCancelled();
+
+    QList<Photo> batch;
+    for (int j = mDelivered; j < ready; ++j)
+    {
+        Item& item = mItems[j];
+        if (!item.error.isEmpty())
+            errors.append(item.error);
+        else if (!cancelled && !item.photo.path.isEmpty())
+            batch.append(item.photo);
+
+        if (!cancelled && item.photo.flags.haveGPSCoord)
+            statistic.add(item.photo.lat(), item.photo.lon());
+
+        item = {}; // not needed anymore
+    }
+
+    mDelivered = ready;
+    mSinceDelivery.restart();
+
+    if (!batch.isEmpty())
+        emit batchLoaded(batch);
+    if (last)
+    {
+        // off the GUI thread, the cache may be large
+        if (mThumbnails)
+            run(QThreadPool::globalInstance(), []{ Cache::instance().saveIfDue(); });
+        emit finished();
+    }
+}
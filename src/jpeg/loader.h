@@ -0,0 +1,82 @@
+#ifndef JPEG_LOADER_H
+#define JPEG_LOADER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QList>
+#include <QThreadPool>
+#include <QVector>
+
+#include "exif/reader.h"
+#include "gpx/statistic.h"
+
+#include "fileprocessor.h"
+#include "photo.h"
+
+namespace jpeg
+{
+
+/// Loads photos in the background. Every file goes through two stages:
+/// reading the GPS and time tags on the I/O pool (sized for the storage latency),
+/// then making the thumbnail on the CPU pool (sized for the cores).
+/// Loaded photos are delivered in the order of the file names, in batches.
+/// Photos unchanged since they were loaded last time are taken from jpeg::Cache, skipping both stages.
+class Loader : public FileProcessor
+{
+    Q_OBJECT
+
+signals:
+    void batchLoaded(const QList<jpeg::Photo>& batch);
+    void finished();
+
+public:
+    explicit Loader(QObject* parent = nullptr);
+    ~Loader() override;
+
+    void setThreadCount(int count) { mReadPool.setMaxThreadCount(count); mThumbnailPool.setMaxThreadCount(count); }
+    void setThumbnails(bool enabled) { mThumbnails = enabled; }
+
+    void start(const QStringList& fileNames);
+    /// no batchLoaded() after this, finished() still comes
+    void cancel();
+    bool isRunning() const { return mDelivered < mItems.size(); }
+    bool isCancelled() const { return mCancelled.loadAcquire(); }
+
+    /// synchronous version: waits for all the files and stores the result in \a loaded
+    /// \return false if it was cancelled or any file failed, see \a errors
+    bool load(const QStringList& fileNames);
+
+    QList<Photo> loaded; // filled by load() only
+    Statistic statistic; // of the photos delivered so far
+
+private:
+    struct Item
+    {
+        QString path;
+        QFileInfo file;
+        Photo photo;
+        Exif::Reader exif; // APP1, the EXIF thumbnail is taken from it by the second stage
+        QString error;
+    };
+
+    void read(int i);
+    void makeThumbnail(int i);
+    void done(int i);
+    void onDone(int i);
+
+    QVector<Item> mItems; // each one is touched by a single stage at a time
+    QVector<bool> mDone; // accessed from the owner thread only
+    int mDoneCount = 0;
+    int mDelivered = 0;
+    QAtomicInt mCancelled;
+    QElapsedTimer mSinceDelivery;
+    bool mThumbnails = true; // the cache is used only along with thumbnails
+
+    QThreadPool mReadPool;
+    QThreadPool mThumbnailPool;
+};
+
+} // namespace jpeg
+
+#endif // JPEG_LOADER_H
@@ -0,0 +1,41 @@
+#ifndef JPEG_PHOTO_H
+#define JPEG_PHOTO_H
+
+#include <QDateTime>
+#include <QGeoCoordinate>
+#include <QImage>
+#include <QPointF>
+#include <QString>
+
+#include <cstring>
+
+namespace jpeg
+{
+
+struct Photo
+{
+    QString path;
+    QString name;
+    QDateTime time; // shot time from EXIF or last modified
+    QPointF position;
+    double altitude = 0.;
+    QImage thumbnail; // null if not available
+    qint64 fileSize = 0;     // when loaded, to tell if the file is changed since
+    qint64 fileModified = 0; // msecs since epoch
+    struct Flags
+    {
+        Flags() { memset(this, 0, sizeof(Flags)); }
+
+        uint8_t haveShotTime : 1; // have EXIF digitized / original timestamp in the file
+        uint8_t haveGPSCoord : 1; // have EXIF GPS position tags in the file
+        uint8_t coordGuessed : 1; // position guessed from time and track
+    } flags;
+
+    double lat() const { return position.x(); }
+    double lon() const { return position.y(); }
+    void setPosition(const QGeoCoordinate& coord) { position = { coord.latitude(), coord.longitude() }; }
+};
+
+} // namespace jpeg
+
+#endif // JPEG_PHOTO_H
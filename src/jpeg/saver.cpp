@@ -0,0 +1,136 @@
+#include "saver.h"
+
+#include <QDataStream>
+#include <QDebug>
+#include <QEventLoop>
+#include <QThread>
+
+#include "exif/file.h"
+#include "exif/utils.h"
+#include "task.h"
+
+jpeg::Saver::Saver(QObject* parent) :
+    FileProcessor(parent),
+    mJournal(Journal::defaultFileName())
+{
+    // writes are mostly waiting for the storage, keep its queue busy
+    mPool.setMaxThreadCount(std::max(4, QThread::idealThreadCount() * 2));
+}
+
+jpeg::Saver::~Saver()
+{
+    cancel();
+    mPool.waitForDone();
+}
+
+// TODO add QDir where to save
+void jpeg::Saver::start(const QList<Photo>& items, qint64 addsecs)
+{
+    Q_ASSERT(!isRunning());
+
+    errors.clear();
+    mItems = items;
+    mAddSecs = addsecs;
+    mErrors = QVector<QString>(items.size());
+    mDoneCount = 0;
+    mSaved = 0;
+    mCancelled.storeRelease(0);
+
+    if (!mJournal.open())
+        qWarning() << "jpeg::Saver: unable to open the journal:" << mJournal.errorString();
+
+    if (mItems.isEmpty()) {
+        QMetaObject::invokeMethod(this, &Saver::finished, Qt::QueuedConnection);
+        return;
+    }
+
+    emit progress(0, mItems.size());
+
+    for (int i = 0; i < mItems.size(); ++i)
+        run(&mPool, [this, i]{ write(i); });
+}
+
+bool jpeg::Saver::save(const QList<Photo>& items, qint64 addsecs)
+{
+    QEventLoop loop;
+    connect(this, &Saver::finished, &loop, &QEventLoop::quit);
+    start(items, addsecs);
+    loop.exec();
+
+    return errors.isEmpty() && !isCancelled();
+}
+
+/// runs in the pool
+void jpeg::Saver::write(int i)
+{
+    const Photo& item = mItems.at(i);
+    bool saved = false;
+
+    auto done = [this, &saved]{
+        QMetaObject::invokeMethod(this, [this, saved]{ onDone(saved); }, Qt::QueuedConnection);
+    };
+
+    if (isCancelled() || !item.flags.coordGuessed)
+        return done();
+
+    QByteArray timeString;
+    if (mAddSecs && item.time.isValid()) {
+        const QString pattern = "yyyy:MM:dd hh:mm:ss";
+        timeString = item.time.addSecs(mAddSecs).toString(pattern).toLatin1();
+    }
+
+    // what goes to the file, the same file saved with the same values before is skipped
+    QByteArray values;
+    QDataStream(&values, QIODevice::WriteOnly) << item.lat() << item.lon() << item.altitude << timeString;
+    if (mJournal.contains(item.path, values))
+        return done();
+
+    Exif::File exif;
+    if (!exif.load(item.path)) {
+        mErrors[i] = tr("Unable to read EXIF from '%1'").arg(item.path);
+        return done();
+    }
+
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE, Exif::Utils::toDMS(item.lat()));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE_REF, Exif::Utils::toLatitudeRef(item.lat()));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE, Exif::Utils::toDMS(item.lon()));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE_REF, Exif::Utils::toLongitudeRef(item.lon()));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE, Exif::Utils::toSingleRational(item.altitude));
+    exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE_REF, Exif::Utils::toAltitudeRef(item.altitude));
+
+    if (!timeString.isEmpty()) {
+        exif.setValue(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL, timeString);
+        exif.setValue(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZED, timeString);
+    }
+
+    // TODO save as
+    if (!exif.save(item.path)) {
+        mErrors[i] = tr("Unable to save EXIF to '%1'").arg(item.path);
+        return done();
+    }
+
+    if (!mJournal.commit(item.path, values))
+        qWarning() << "jpeg::Saver: unable to write the journal:" << mJournal.errorString();
+
+    saved = true;
+    done();
+}
+
+void jpeg::Saver::onDone(bool saved)
+{
+    if (saved)
+        ++mSaved;
+    emit progress(++mDoneCount, mItems.size());
+
+    if (mDoneCount < mItems.size())
+        return;
+
+    for (const QString& error: qAsConst(mErrors))
+        if (!error.isEmpty())
+            errors.append(error);
+
+    if (errors.isEmpty() && !isCancelled())
+        mJournal.remove();
+
+    emit finished();
+}
@@ -0,0 +1,60 @@
+#ifndef JPEG_SAVER_H
+#define JPEG_SAVER_H
+
+#include <QAtomicInt>
+#include <QList>
+#include <QThreadPool>
+#include <QVector>
+
+#include "fileprocessor.h"
+#include "journal.h"
+#include "photo.h"
+
+namespace jpeg
+{
+
+/// Writes the guessed positions in the background, several files at once.
+/// Each file is committed on its own (see Exif::File::save) and recorded in the journal,
+/// so saving again after a crash or a cancel skips the files already written with the same values.
+class Saver : public FileProcessor
+{
+    Q_OBJECT
+
+signals:
+    void finished();
+
+public:
+    explicit Saver(QObject* parent = nullptr);
+    ~Saver() override;
+
+    void setThreadCount(int count) { mPool.setMaxThreadCount(count); }
+
+    void start(const QList<Photo>& items, qint64 addsecs);
+    void cancel() { mCancelled.storeRelease(1); }
+    bool isRunning() const { return mDoneCount < mItems.size(); }
+    bool isCancelled() const { return mCancelled.loadAcquire(); }
+
+    /// synchronous version
+    bool save(const QList<Photo>& items, qint64 addsecs);
+
+    int saved() const { return mSaved; }
+    QString error(int i) const { return mErrors.value(i); }
+
+private:
+    void write(int i);
+    void onDone(bool saved);
+
+    QList<Photo> mItems;
+    qint64 mAddSecs = 0;
+    QVector<QString> mErrors; // per item, each one written by a single task
+    int mDoneCount = 0;
+    int mSaved = 0;
+    QAtomicInt mCancelled;
+
+    Journal mJournal;
+    QThreadPool mPool;
+};
+
+} // namespace jpeg
+
+#endif // JPEG_SAVER_H
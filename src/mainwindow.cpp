@@ -4,12 +4,14 @@
 #include <QDateTime>
 #include <QDebug>
 #include <QDesktopServices>
-#include <QDirIterator>
+#include <QDir>
+#include <QDockWidget>
 #include <QFileDialog>
 #include <QMessageBox>
 #include <QMimeData>
 #include <QPixmap>
 #include <QQmlContext>
+#include <QSet>
 #include <QSettings>
 #include <QStandardPaths>
 #include <QStringList>
@@ -18,11 +20,19 @@
 
 #include <cmath>
 
-#include "gpx/loader.h"
+#include "gpx/collection.h"
+#include "jpeg/cache.h"
+#include "jpeg/loader.h"
+#include "jpeg/saver.h"
 
 #include "abstractsettings.h"
+#include "folderwatcher.h"
+#include "jobpanel.h"
+#include "markermodel.h"
 #include "model.h"
 #include "selectionwatcher.h"
+#include "task.h"
+#include "thumbnailprovider.h"
 #include "timeadjustwidget.h"
 
 struct Settings : AbstractSettings
@@ -47,7 +57,8 @@ struct Settings : AbstractSettings
     } window;
 
     struct {
-        Tag<QString> gpx = "session/gpx";
+        // the file lists of the versions before Session, only read
+        Tag<QStringList> gpx = "session/gpx";
         Tag<QStringList> photos = "session/photos";
         Tag<bool> restore = "session/restore";
     } session;
@@ -77,31 +88,31 @@ public:
 
 struct Dropped
 {
-    QString gpx;
+    QStringList gpx;
     QStringList photos;
+    QStringList folders; // watched, not walked here
 
     explicit Dropped(const QMimeData* mime) {
         for (const QUrl& url: mime->urls()) {
             append(url.toLocalFile());
         }
+        std::sort(gpx.begin(), gpx.end());
         std::sort(photos.begin(), photos.end());
     }
 
     bool isEmpty() const {
-        return gpx.isEmpty() && photos.isEmpty();
+        return gpx.isEmpty() && photos.isEmpty() && folders.isEmpty();
     }
 
     void append(const QFileInfo& file) {
         if (file.isDir()) {
-            QDirIterator i(file.absoluteFilePath(), QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
-            while (i.hasNext())
-                append(i.next());
+            folders.append(file.absoluteFilePath());
             return;
         }
 
         if (file.isFile()) {
-            if (file.suffix().compare("gpx", Qt::CaseInsensitive) == 0)
-                gpx = file.absoluteFilePath();
+            if (QDir::match(GPX::Loader::nameFilters(), file.fileName()))
+                gpx.append(file.absoluteFilePath());
 
             if (file.suffix().compare("jpg", Qt::CaseInsensitive) == 0 ||
                 file.suffix().compare("jpeg", Qt::CaseInsensitive) == 0)
@@ -114,7 +125,10 @@ MainWindow::MainWindow(QWidget* parent) :
     QMainWindow(parent),
     ui(new Ui::MainWindow),
     mModel(new Model),
-    mSelection(new SelectionWatcher)
+    mMarkers(new MarkerModel(mModel)),
+    mSelection(new SelectionWatcher),
+    mFolders(new FolderWatcher(this)),
+    mJobs(new Jobs(this))
 {
     ui->setupUi(this);
     connect(ui->map, &QQuickWidget::statusChanged, [this](QQuickWidget::Status status){
@@ -132,7 +146,9 @@ MainWindow::MainWindow(QWidget* parent) :
 
     QQmlEngine* engine = ui->map->engine();
     engine->rootContext()->setContextProperty("controller", mModel);
+    engine->rootContext()->setContextProperty("markers", mMarkers);
     engine->rootContext()->setContextProperty("selection", mSelection);
+    engine->addImageProvider(ThumbnailProvider::Name, new ThumbnailProvider(mModel)); // owned by the engine
     ui->map->setSource(QUrl("qrc:///qml/map.qml"));
 
     ui->photos->setModel(mModel);
@@ -151,7 +167,19 @@ MainWindow::MainWindow(QWidget* parent) :
         ui->photos->setCurrentIndex(mModel->index(current));
     });
 
+    ui->progressBar->setRange(0, 100);
     ui->progressBar->hide();
+    connect(mJobs, &Jobs::busyChanged, ui->progressBar, &QProgressBar::setVisible);
+    connect(mJobs, &Jobs::progress, ui->progressBar, &QProgressBar::setValue);
+
+    auto jobsDock = new QDockWidget(tr("Jobs"), this);
+    jobsDock->setObjectName("jobsDock"); // for saveState()
+    jobsDock->setWidget(new JobPanel(mJobs));
+    addDockWidget(Qt::BottomDockWidgetArea, jobsDock);
+    jobsDock->hide();
+    ui->menu_View->addAction(jobsDock->toggleViewAction());
+
+    connect(mFolders, &FolderWatcher::changed, this, &MainWindow::onFoldersChanged);
 
     connect(mModel, &Model::trackChanged, this, [this](int reason){
         const auto& track = mModel->track();
@@ -164,8 +192,8 @@ MainWindow::MainWindow(QWidget* parent) :
             return;
         }
 
-        ui->startTime->setText(track.first().timestamp().time().toString());
-        ui->finishTime->setText(track.last().timestamp().time().toString());
+        ui->startTime->setText(track.timestamp(0).time().toString());
+        ui->finishTime->setText(track.timestamp(track.size() - 1).time().toString());
     });
 
     connect(mModel, &Model::rowsInserted, this, [this]{
@@ -175,7 +203,6 @@ MainWindow::MainWindow(QWidget* parent) :
 
     connect(ui->timeAdjistWidget, &TimeAdjustWidget::changed, this, [this]{
         mModel->setTimeAdjust(ui->timeAdjistWidget->value());
-        mModel->guessPhotoCoordinates();
     });
     ui->timeAdjistWidget->hide();
 
@@ -189,6 +216,8 @@ MainWindow::MainWindow(QWidget* parent) :
 void MainWindow::closeEvent(QCloseEvent*)
 {
     saveSettings();
+    // the photos loaded since the last save, see jpeg::Cache::saveIfDue()
+    jpeg::Cache::saveInstance();
 }
 
 void MainWindow::dragEnterEvent(QDragEnterEvent* e)
@@ -210,6 +239,8 @@ void MainWindow::dropEvent(QDropEvent* e)
         loadGPX(dropped.gpx);
     if (!dropped.photos.isEmpty())
         addPhotos(dropped.photos);
+    for (const QString& folder: dropped.folders)
+        mFolders->addFolder(folder);
 }
 
 void MainWindow::showEvent(QShowEvent* e)
@@ -229,6 +260,7 @@ MainWindow::~MainWindow()
     // QML-used objects needs to live long enough for the QML engine to complete all the operations
     // so don't pass 'this' to the ctor of these objects and delete it after
 
+    mMarkers->deleteLater();
     mModel->deleteLater();
     mSelection->deleteLater();
 }
@@ -239,8 +271,101 @@ void MainWindow::restoreSession()
 
     if (!settings.session.restore) return;
 
-    loadGPX(settings.session.gpx);
-    addPhotos(settings.session.photos);
+    Session session;
+    if (!session.load())
+    {
+        loadGPX(settings.session.gpx);
+        addPhotos(settings.session.photos);
+        // the index tells what the lost snapshot had, so the folders are listed as a whole
+        if (mFolders->load())
+            mFolders->relist();
+        return;
+    }
+
+    // the previous state is shown at once, without parsing anything
+    mTrackFiles = session.trackFiles;
+    mTrackTitle = session.title;
+    setTitle(mTrackTitle);
+    if (!session.track.isEmpty())
+        mModel->setTrack(session.track);
+    mModel->add(session.photos);
+    if (mFolders->load())
+        mFolders->rescan(); // only the differences are loaded
+    if (session.center.isValid())
+    {
+        mModel->setCenter(session.center);
+        mModel->setZoom(session.zoom);
+    }
+
+    const qint64 timeAdjust = session.timeAdjust;
+    ui->timeAdjistWidget->setDays(static_cast<int>(timeAdjust / (24 * 60 * 60)));
+    ui->timeAdjistWidget->setHours(static_cast<int>(timeAdjust / (60 * 60) % 24));
+    ui->timeAdjistWidget->setMinutes(static_cast<int>(timeAdjust / 60 % 60));
+    ui->timeAdjistWidget->setSeconds(static_cast<int>(timeAdjust % 60));
+
+    // then the files changed since are loaded again
+    run(&mSessionPool, [this, session]{
+        const Session::Changes changes = session.changes();
+        if (!changes.isEmpty())
+            QMetaObject::invokeMethod(this, [this, changes]{ applySessionChanges(changes); }, Qt::QueuedConnection);
+    });
+}
+
+void MainWindow::applySessionChanges(const Session::Changes& changes)
+{
+    qInfo() << "Session:" << changes.changedPhotos.size() << "photo(s) changed," << changes.missingPhotos.size() << "missing"
+            << (changes.trackChanged ? ", the track changed" : "");
+
+    if (changes.trackChanged)
+    {
+        QStringList fileNames;
+        for (const Session::File& file: qAsConst(mTrackFiles))
+            if (QFileInfo::exists(file.path))
+                fileNames.append(file.path);
+        loadGPX(fileNames); // the restored track stays if there is nothing to load
+    }
+
+    QSet<QString> stale;
+    for (const QString& path: changes.changedPhotos + changes.missingPhotos)
+        stale.insert(path);
+    mModel->removeFiles(stale);
+
+    if (!changes.changedPhotos.isEmpty())
+        addPhotos(changes.changedPhotos);
+}
+
+/// the snapshot of the track and the photos to restore on the next start
+void MainWindow::saveSession()
+{
+    Session session;
+    if (!ui->actionRestore_session_on_startup->isChecked())
+    {
+        session.remove();
+        FolderWatcher::remove();
+        return;
+    }
+
+    // the index tells which files are in the model already, it's wrong while the photos are loaded:
+    // then only the folders are kept, to be listed again as a whole
+    if (mFolders->folders().isEmpty())
+        FolderWatcher::remove();
+    else if (mJobs->isBusy())
+        mFolders->saveFolders();
+    else
+        mFolders->save();
+
+    session.trackFiles = mTrackFiles;
+    session.title = mTrackTitle;
+    session.track = mModel->track();
+    session.photos = mModel->photos();
+    for (jpeg::Photo& photo: session.photos)
+        photo.thumbnail = mModel->thumbnailOf(photo.path);
+    session.timeAdjust = mModel->timeAdjust();
+    session.center = mModel->center();
+    session.zoom = mModel->zoom();
+
+    if (!session.save())
+        qWarning().noquote() << "Unable to save the session:" << session.errorString();
 }
 
 void MainWindow::loadSettings()
@@ -277,10 +402,9 @@ void MainWindow::saveSettings()
     settings.window.adjustTimestamp.m = ui->timeAdjistWidget->minutes();
     settings.window.adjustTimestamp.s = ui->timeAdjistWidget->seconds();
 
-    QStringList photos;
-    for (int row = 0; row < mModel->rowCount(); ++row)
-        photos += mModel->data(mModel->index(row), Model::Role::Path).toString();
-    settings.session.photos = photos;
+    saveSession();
+    settings.session.gpx = {};
+    settings.session.photos = {};
 
     settings.session.restore = ui->actionRestore_session_on_startup->isChecked();
     settings.followSelection = ui->actionFollow_selection->isChecked();
@@ -335,35 +459,51 @@ void MainWindow::on_actionLoadTrack_triggered()
 
     QString directory = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
     directory = settings.dirs.gpx(directory);
-    QString name = QFileDialog::getOpenFileName(this, "", directory, "*.gpx");
-    if (name.isEmpty()) return;
+    QStringList names = QFileDialog::getOpenFileNames(this, "", directory, GPX::Loader::nameFilters().join(' '));
+    if (names.isEmpty()) return;
 
-    directory = QFileInfo(name).absoluteDir().absolutePath();
+    directory = QFileInfo(names.first()).absoluteDir().absolutePath();
     settings.dirs.gpx = directory;
     if (settings.dirs.photo.isNull())
         settings.dirs.photo = directory;
 
-    loadGPX(name);
+    loadGPX(names);
 }
 
-bool MainWindow::loadGPX(const QString& fileName)
+/// loads the tracks of a trip as one, e.g. a file per day
+bool MainWindow::loadGPX(const QStringList& fileNames)
 {
-    if (fileName.isEmpty()) return false;
+    if (fileNames.isEmpty()) return false;
 
-    GPX::Loader loader;
-    if (!loader.load(fileName))
-        return warn(tr("Unable to load GPX file"), loader.lastError());
+    auto tracks = new GPX::Collection(this);
+    connect(tracks, &GPX::Collection::finished, this, [this, tracks]{
+        tracks->deleteLater();
+        if (tracks->isCancelled())
+            return;
 
-    setTitle(loader.name());
+        if (!tracks->errors().isEmpty())
+            warn(tr("Unable to load GPX file"), tracks->errors().join("\n"));
+        if (tracks->fileNames().isEmpty())
+            return;
 
-    mModel->setTrack(loader.track());
-    if (loader.statistic().total())
-    {
-        mModel->setCenter(loader.statistic().center());
-        mModel->setZoom(loader.statistic().zoom(ui->map->size()));
-    }
+        mTrackTitle = tracks->names().join(", ");
+        setTitle(mTrackTitle);
+
+        mModel->setTrack(tracks->track());
+        if (tracks->statistic().total())
+        {
+            mModel->setCenter(tracks->statistic().center());
+            mModel->setZoom(tracks->statistic().zoom(ui->map->size()));
+        }
+
+        mTrackFiles.clear();
+        for (const QString& fileName: tracks->fileNames())
+            mTrackFiles.append(Session::File::stat(fileName));
+    });
 
-    Settings().session.gpx = fileName;
+    // the track is what the photos are matched against, so it doesn't wait for them
+    mJobs->add(tr("Loading %n track file(s)", "", fileNames.size()), Jobs::Interactive, tracks,
+               [tracks, fileNames]{ tracks->start(fileNames); });
     return true;
 }
 
@@ -385,59 +525,77 @@ void MainWindow::on_actionAddPhotos_triggered()
     addPhotos(names);
 }
 
-void MainWindow::on_action_Clear_triggered()
+void MainWindow::on_actionWatchFolder_triggered()
 {
-    mModel->clear();
-    onCurrentChanged({});
-
     Settings settings;
-    settings.session.gpx = {};
-    settings.session.photos = {};
 
-    setTitle();
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::DocumentsLocation);
+    directory = settings.dirs.photo(directory);
+    directory = QFileDialog::getExistingDirectory(this, "", directory);
+    if (directory.isEmpty()) return;
+
+    settings.dirs.photo = directory;
+    mFolders->addFolder(directory);
 }
 
-template <class ProgressSignaller>
-class ProgressHandler
+void MainWindow::on_action_Clear_triggered()
 {
-    QProgressBar* mProgressBar;
+    // saving goes on
+    for (jpeg::Loader* loader: findChildren<jpeg::Loader*>())
+        mJobs->cancel(loader);
+    for (GPX::Collection* tracks: findChildren<GPX::Collection*>())
+        mJobs->cancel(tracks);
 
-public:
-    ProgressHandler(ProgressSignaller* signaller, QProgressBar* bar) : mProgressBar(bar) {
-        Q_ASSERT(mProgressBar);
-        QObject::connect(signaller, &ProgressSignaller::progress, signaller, [this](int current, int total){
-            mProgressBar->setMaximum(total);
-            mProgressBar->setValue(current);
-        });
-        mProgressBar->setValue(0);
-        mProgressBar->show();
-    }
+    mModel->clear();
+    mFolders->clear();
+    onCurrentChanged({});
 
-    ~ProgressHandler() { mProgressBar->hide(); }
-};
+    mTrackFiles.clear();
+    mTrackTitle.clear();
+    setTitle();
+}
 
-bool MainWindow::addPhotos(const QStringList& fileNames)
+bool MainWindow::addPhotos(const QStringList& fileNames, bool fitMap, Jobs::Priority priority)
 {
-    jpeg::Loader loader;
-    ProgressHandler progressHandler(&loader, ui->progressBar);
+    // loaded in the background, the photos appear in the model batch by batch
+    auto loader = new jpeg::Loader(this);
 
-    if (!loader.load(fileNames))
-        return warn(tr("Unable to load photos"), loader.errors.join("\n"));
+    connect(loader, &jpeg::Loader::batchLoaded, mModel, &Model::add);
+    connect(loader, &jpeg::Loader::finished, this, [this, loader, fitMap]{
+        loader->deleteLater();
+        if (loader->isCancelled())
+            return;
 
-    if (!loader.loaded.isEmpty())
-    {
-        mModel->add(loader.loaded);
-        if (loader.statistic.total())
+        if (fitMap && loader->statistic.total())
         {
-            mModel->setCenter(loader.statistic.center());
-            mModel->setZoom(loader.statistic.zoom(ui->map->size()));
+            mModel->setCenter(loader->statistic.center());
+            mModel->setZoom(loader->statistic.zoom(ui->map->size()));
         }
-    }
 
-    Settings().session.photos = fileNames;
+        if (!loader->errors.isEmpty())
+            warn(tr("Unable to load photos"), loader->errors.join("\n"));
+    });
+
+    mJobs->add(tr("Adding %n photo(s)", "", fileNames.size()), priority, loader,
+               [loader, fileNames]{ loader->start(fileNames); });
     return true;
 }
 
+/// applies the changes found in the watched folders to the model
+void MainWindow::onFoldersChanged(const QStringList& created, const QStringList& modified, const QStringList& removed)
+{
+    QSet<QString> stale;
+    for (const QString& path: modified + removed)
+        stale.insert(path);
+    if (!stale.isEmpty())
+        mModel->removeFiles(stale);
+
+    QStringList added = created + modified;
+    std::sort(added.begin(), added.end());
+    if (!added.isEmpty())
+        addPhotos(added, mModel->rowCount() == 0, Jobs::Background); // the map isn't moved by a few new photos
+}
+
 void MainWindow::setTitle(const QString& title)
 {
     setWindowTitle(title.isEmpty() ? tr("geotagger %1").arg(qApp->applicationVersion()) : title);
@@ -461,16 +619,31 @@ void MainWindow::on_actionSave_EXIF_triggered()
     if (QMessageBox::question(this, "", tr("Overwrite existing files?")) != QMessageBox::Yes)
         return;
 
-    jpeg::Saver saver;
-    ProgressHandler progressHandler(&saver, ui->progressBar);
+    // written in the background; if interrupted, saving the same photos again resumes the job
+    auto saver = new jpeg::Saver(this);
+    ui->actionSave_EXIF->setEnabled(false);
 
-    if (!saver.save(mModel->photos(), mModel->timeAdjust())) {
-        warn(tr("Save failed"), saver.errors.join("\n"));
-        return;
-    }
+    connect(saver, &jpeg::Saver::finished, this, [this, saver]{
+        saver->deleteLater();
+        ui->actionSave_EXIF->setEnabled(mModel->rowCount() > 0);
 
-    QMessageBox::information(this, "", tr("Saved succesfully"));
+        if (saver->isCancelled())
+            return;
+
+        if (!saver->errors.isEmpty()) {
+            warn(tr("Save failed"), saver->errors.join("\n"));
+            return;
+        }
+
+        QMessageBox::information(this, "", tr("Saved succesfully"));
+
+        QString firstFile = mModel->data(mModel->index(0), Model::Role::Path).toString();
+        QDesktopServices::openUrl(QUrl::fromLocalFile(QFileInfo(firstFile).absolutePath()));
+    });
 
-    QString firstFile = mModel->data(mModel->index(0), Model::Role::Path).toString();
-    QDesktopServices::openUrl(QUrl::fromLocalFile(QFileInfo(firstFile).absolutePath()));
+    // the photos as they are now, the save may wait for the other jobs
+    const QList<jpeg::Photo> photos = mModel->photos();
+    const qint64 timeAdjust = mModel->timeAdjust();
+    mJobs->add(tr("Saving %n photo(s)", "", photos.size()), Jobs::Normal, saver,
+               [saver, photos, timeAdjust]{ saver->start(photos, timeAdjust); });
 }
@@ -3,6 +3,10 @@
 
 #include <QMainWindow>
 #include <QString>
+#include <QThreadPool>
+
+#include "jobs.h"
+#include "session.h"
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -10,6 +14,8 @@ class QStringList;
 class QMimeData;
 QT_END_NAMESPACE
 
+class FolderWatcher;
+class MarkerModel;
 class Model;
 class SelectionWatcher;
 class TimeAdjustWidget;
@@ -25,6 +31,7 @@ public:
 private slots:
     void on_actionLoadTrack_triggered();
     void on_actionAddPhotos_triggered();
+    void on_actionWatchFolder_triggered();
     void on_action_Clear_triggered();
     void on_actionAdjust_photo_timestamp_toggled(bool toggled);
     void on_actionE_xit_triggered();
@@ -39,9 +46,12 @@ private:
     void loadSettings();
     void saveSettings();
 
-    bool loadGPX(const QString& fileName);
-    bool addPhotos(const QStringList& fileNames);
+    bool loadGPX(const QStringList& fileNames);
+    bool addPhotos(const QStringList& fileNames, bool fitMap = true, Jobs::Priority priority = Jobs::Normal);
+    void onFoldersChanged(const QStringList& created, const QStringList& modified, const QStringList& removed);
     void restoreSession();
+    void saveSession();
+    void applySessionChanges(const Session::Changes& changes);
     void setTitle(const QString& title = {});
 
     void onCurrentChanged(const QModelIndex& index);
@@ -51,6 +61,13 @@ private:
 
     Ui::MainWindow* ui = nullptr;
     Model* mModel = nullptr;
+    MarkerModel* mMarkers = nullptr;
     SelectionWatcher* mSelection = nullptr;
+    FolderWatcher* mFolders = nullptr;
+    Jobs* mJobs = nullptr;
+
+    QList<Session::File> mTrackFiles; // loaded
+    QString mTrackTitle;
+    QThreadPool mSessionPool; // checks the restored files
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,184 @@
+#include "markermodel.h"
+
+#include <QHash>
+#include <QtMath>
+
+#include <cmath>
+
+#include "gpx/mercator.h"
+#include "model.h"
+
+MarkerModel::MarkerModel(const Model* source) : mSource(source)
+{
+    mRebuild.setSingleShot(true);
+    mRebuild.setInterval(0);
+    connect(&mRebuild, &QTimer::timeout, this, &MarkerModel::rebuild);
+
+    // positions move all together while the time is adjusted and photos are removed one by one,
+    // so it's rebuilt once per event loop pass
+    auto schedule = [this]{ mRebuild.start(); };
+    connect(mSource, &Model::dataChanged, this, schedule);
+    connect(mSource, &Model::rowsInserted, this, schedule);
+    connect(mSource, &Model::rowsRemoved, this, schedule);
+    connect(mSource, &Model::modelReset, this, schedule);
+}
+
+void MarkerModel::setViewport(const QGeoCoordinate& topLeft, const QGeoCoordinate& bottomRight, qreal zoom)
+{
+    // zoomed out, a corner is beyond the edge of the world and has no coordinate
+    const QPointF tl = topLeft.isValid() ? GPX::mercator(topLeft.latitude(), topLeft.longitude()) : QPointF(0, 0);
+    const QPointF br = bottomRight.isValid() ? GPX::mercator(bottomRight.latitude(), bottomRight.longitude()) : QPointF(1, 1);
+
+    // a cell is about a marker wide: 256-pixel world at zoom 0, doubling with every level
+    mViewport = QRectF(tl, br);
+    mLevel = qBound(0, static_cast<int>(std::floor(zoom)) + 8 - static_cast<int>(std::log2(MarkerSize)), SpatialIndex::Depth);
+
+    if (mRebuild.isActive())
+        rebuild(); // the index may refer to the removed rows
+    else
+        update();
+}
+
+void MarkerModel::rebuild()
+{
+    mRebuild.stop();
+
+    QVector<QPointF> points;
+    QVector<int> rows;
+    const QList<jpeg::Photo>& photos = mSource->photos();
+    for (int row = 0; row < photos.size(); ++row)
+    {
+        const jpeg::Photo& photo = photos[row];
+        if (qFuzzyIsNull(photo.lat()) && qFuzzyIsNull(photo.lon()))
+            continue; // no position
+
+        points.append(GPX::mercator(photo.lat(), photo.lon()));
+        rows.append(row);
+    }
+
+    mIndex.build(points, rows);
+    update();
+}
+
+QVector<MarkerModel::Marker> MarkerModel::markers() const
+{
+    QVector<Marker> markers;
+    if (mIndex.isEmpty() || mViewport.isNull())
+        return markers;
+
+    // the viewport crossing the antimeridian is two rectangles
+    QVector<QRectF> rects;
+    if (mViewport.left() <= mViewport.right()) {
+        rects.append(mViewport);
+    } else {
+        rects.append(QRectF(QPointF(mViewport.left(), mViewport.top()), QPointF(1., mViewport.bottom())));
+        rects.append(QRectF(QPointF(0., mViewport.top()), QPointF(mViewport.right(), mViewport.bottom())));
+    }
+
+    const double cells = std::ldexp(1., mLevel);
+    for (const QRectF& rect: qAsConst(rects))
+    {
+        for (const SpatialIndex::Cell& cell: mIndex.cells(rect, mLevel))
+        {
+            Marker marker;
+            marker.count = cell.size();
+            if (marker.count == 1) {
+                marker.row = mIndex.id(cell.begin);
+                const jpeg::Photo& photo = mSource->photos()[marker.row];
+                marker.key = photo.path;
+                marker.position = QGeoCoordinate(photo.lat(), photo.lon());
+            } else {
+                marker.key = QString("%1/%2/%3").arg(mLevel)
+                                                .arg(static_cast<qint64>(cell.center.x() * cells))
+                                                .arg(static_cast<qint64>(cell.center.y() * cells));
+                const double lon = cell.center.x() * 360. - 180.;
+                const double lat = qRadiansToDegrees(std::atan(std::sinh(M_PI * (1. - 2. * cell.center.y()))));
+                marker.position = QGeoCoordinate(lat, lon);
+            }
+            markers.append(marker);
+        }
+    }
+
+    return markers;
+}
+
+/// updates the markers in place, so the map keeps the delegates of the markers still shown
+void MarkerModel::update()
+{
+    const QVector<Marker> markers = this->markers();
+
+    QHash<QString, int> wanted; // key -> index in markers
+    for (int i = 0; i < markers.size(); ++i)
+        wanted.insert(markers[i].key, i);
+
+    for (int row = mMarkers.size() - 1; row >= 0; --row)
+    {
+        if (wanted.contains(mMarkers[row].key))
+            continue;
+        beginRemoveRows({}, row, row);
+        mMarkers.removeAt(row);
+        endRemoveRows();
+    }
+
+    for (int row = 0; row < mMarkers.size(); ++row)
+    {
+        Marker& marker = mMarkers[row];
+        const Marker& updated = markers[wanted.take(marker.key)];
+        if (marker.row != updated.row || marker.count != updated.count || marker.position != updated.position) {
+            marker = updated;
+            emit dataChanged(index(row), index(row));
+        }
+    }
+
+    // the ones left are new
+    if (!wanted.isEmpty()) {
+        QVector<int> added = wanted.values().toVector();
+        std::sort(added.begin(), added.end());
+        beginInsertRows({}, mMarkers.size(), mMarkers.size() + added.size() - 1);
+        for (int i: qAsConst(added))
+            mMarkers.append(markers[i]);
+        endInsertRows();
+    }
+}
+
+int MarkerModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : mMarkers.size();
+}
+
+QVariant MarkerModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid() || index.row() >= mMarkers.size())
+        return {};
+
+    const Marker& marker = mMarkers[index.row()];
+
+    if (role == Role::Count)
+        return marker.count;
+
+    if (marker.row >= 0) {
+        // until rebuilt, the source rows may be shifted by a removal
+        const QList<jpeg::Photo>& photos = mSource->photos();
+        if (marker.row < photos.size() && photos[marker.row].path == marker.key)
+            return mSource->data(mSource->index(marker.row), role);
+        return {};
+    }
+
+    switch (role)
+    {
+    case Model::Role::Index:        return -1;
+    case Model::Role::Name:         return QString::number(marker.count);
+    case Model::Role::Latitude:     return marker.position.latitude();
+    case Model::Role::Longitude:    return marker.position.longitude();
+    case Model::Role::Path:
+    case Model::Role::Pixmap:       return QString();
+    default:                        return {};
+    }
+}
+
+QHash<int, QByteArray> MarkerModel::roleNames() const
+{
+    QHash<int, QByteArray> roles = mSource->roleNames();
+    roles[Role::Count] = "_count_";
+    return roles;
+}
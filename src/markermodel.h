@@ -0,0 +1,61 @@
+#ifndef MARKERMODEL_H
+#define MARKERMODEL_H
+
+#include <QAbstractListModel>
+#include <QGeoCoordinate>
+#include <QQmlEngine>
+#include <QRectF>
+#include <QTimer>
+
+#include "spatialindex.h"
+
+class Model;
+
+/* The photo markers for the map: only the ones in the viewport, and the photos
+   closer than a marker size to each other are shown as a single cluster marker,
+   so the number of markers depends on the screen rather than on the number of photos */
+
+class MarkerModel : public QAbstractListModel
+{
+    Q_OBJECT
+#if QT_VERSION >= QT_VERSION_CHECK(5,15,0)
+    QML_ELEMENT
+#endif
+
+public:
+    struct Role { enum { Count = Qt::UserRole + 100 }; }; // and the Model::Role ones
+
+    explicit MarkerModel(const Model* source); // QML-used objects must be destoyed after QML engine so don't pass parent here
+
+    /// the map area shown, in corner coordinates
+    Q_INVOKABLE void setViewport(const QGeoCoordinate& topLeft, const QGeoCoordinate& bottomRight, qreal zoom);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+private:
+    struct Marker
+    {
+        QString key;   // photo path or cluster cell
+        int row = -1;  // in the source model for a single photo
+        int count = 0; // photos
+        QGeoCoordinate position;
+    };
+
+    void rebuild();
+    void update();
+    QVector<Marker> markers() const;
+
+    static const int MarkerSize = 64; // pixels, a power of 2
+
+    const Model* mSource;
+    SpatialIndex mIndex;
+    QTimer mRebuild; // coalesces the source changes
+
+    QRectF mViewport; // Web Mercator
+    int mLevel = 0;   // of the clustering cells
+    QVector<Marker> mMarkers;
+};
+
+#endif // MARKERMODEL_H
@@ -1,242 +1,94 @@
 #include "model.h"
 
-#include <QBuffer>
-#include <QFileInfo>
+#include <QColor>
 #include <QDateTime>
 #include <QDebug>
-#include <QImageReader>
-#include <QPixmap>
 #include <QPointF>
+#include <QSet>
 
 #include "gpx/loader.h"
 #include "gpx/track.h"
-#include "exif/file.h"
-#include "exif/utils.h"
+#include "task.h"
+#include "thumbnailprovider.h"
 
-namespace Pics
+Model::Model()
 {
+    mPyramidPool.setMaxThreadCount(1);
 
-QPixmap thumbnail(QImageReader* reader, int width, int height)
-{
-    if (width == 0 || height == 0)
-        return QPixmap::fromImageReader(reader);
-
-    QSize size = reader->size();
-
-    double dw = 1.0 * width / size.width();
-    double dh = 1.0 * height / size.height();
-    QSize cropped_size = size * std::max(dw, dh);
-    reader->setScaledSize(cropped_size);
-    reader->setScaledClipRect(QRect((cropped_size.width() - width) / 2,
-                                    (cropped_size.height() - height) / 2,
-                                    width,
-                                    height));
-    return QPixmap::fromImageReader(reader);
+    connect(this, &Model::trackChanged, this, &Model::guessPhotoCoordinates);
 }
 
-QString toBase64(const QPixmap& pixmap)
+void Model::setTrack(const GPX::TrackStore& track)
 {
-    QByteArray raw;
-    QBuffer buff(&raw);
-    buff.open(QIODevice::WriteOnly);
-    pixmap.save(&buff, "JPEG");
-
-    QString base64("data:image/jpg;base64,");
-    base64.append(QString::fromLatin1(raw.toBase64().data()));
-    return base64;
-}
-
-} // namespace Pics
+    mMatcher.setTrack(track);
 
+    // the path appears when the pyramid is ready, there's no use in drawing every point meanwhile
+    mPyramid = {};
+    mLevel = -1;
+    mPath.clearPath();
+    emit pathChanged();
+
+    const int id = ++mPyramidId;
+    run(&mPyramidPool, [this, track, id]{
+        const GPX::Pyramid pyramid = GPX::Pyramid::build(track);
+        QMetaObject::invokeMethod(this, [this, pyramid, id]{
+            if (id != mPyramidId)
+                return; // another track is set already
+            mPyramid = pyramid;
+            updatePath();
+        }, Qt::QueuedConnection);
+    });
 
-void jpeg::Photo::setPosition(const QGeoCoordinate& coord)
-{
-    position = { coord.latitude(), coord.longitude() };
+    emit trackChanged(Reason::Set);
 }
 
-
-bool jpeg::Loader::load(const QStringList& fileNames)
+void Model::add(const QList<jpeg::Photo> photos)
 {
-    if (fileNames.isEmpty()) return true;
-
-    errors.clear();
-    statistic.clear();
-
-    for (QFileInfo file: fileNames)
+    QList<jpeg::Photo> added;
+    for (const jpeg::Photo& item: qAsConst(photos))
     {
-        emit progress(statistic.total(), fileNames.size());
-
-        if (!file.exists())
-        {
-            errors.append(tr("Unable to add '%1': no such file").arg(file.absoluteFilePath()));
-            continue;
-        }
-
-        // TODO check if already contains
-
-        Photo item;
-        item.path = file.absoluteFilePath();
-        item.name = file.baseName();
-        item.time = file.lastModified();
-
-        Exif::File exif;
-        if (!exif.load(file.absoluteFilePath()))
-        {
-            errors.append(tr("Unable to read EXIF from '%1'").arg(file.absoluteFilePath()));
-            continue;
-        }
-
-        {
-            auto lat = exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE);
-            auto lon = exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE);
-            auto alt = exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE);
-            auto latRef = exif.ascii(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE_REF);
-            auto lonRef = exif.ascii(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE_REF);
-            auto altRef = exif.ascii(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE_REF);
-
-            if (!lat.isEmpty() && !lon.isEmpty())
-            {
-                item.setPosition(Exif::Utils::fromLatLon(lat, latRef, lon, lonRef));
-                if (!alt.isEmpty())
-                {
-                    item.altitude = Exif::Utils::fromSingleRational(alt, altRef);
-                }
-
-                item.flags.haveGPSCoord = true;
-
-                statistic.add(item.lat(), item.lon());
-            }
-        }
-
-        {
-            QByteArray timeString = exif.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZED);
-            if (timeString.isEmpty())
-                timeString = exif.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL);
-            // we can also check EXIF_TAG_DATE_TIME in EXIF_IFD_0,
-            // however this one may be the file editing / raw export time
-            QString pattern = "yyyy:MM:dd hh:mm:ss";
-            if (timeString.size() == pattern.size())
-            {
-                QDateTime time = QDateTime::fromString(QString::fromLatin1(timeString), pattern);
-                if (time.isValid())
-                {
-                    item.time = time;
-                    item.flags.haveShotTime = true;
-                }
-            }
-        }
-
+        if (!mPaths.contains(item.path))
         {
-            // TODO move to thread
-            QPixmap pix;
-            QByteArray thumbnail = exif.thumbnail();
-            if (thumbnail.size())
-            {
-                QBuffer buffer(&thumbnail);
-                QImageReader reader(&buffer);
-                pix = Pics::thumbnail(&reader, 32, 32);
-            }
-
-            if (pix.isNull())
-            {
-                QImageReader reader(item.path);
-                pix = Pics::thumbnail(&reader, 32, 32);
-            }
-
-            if (pix.isNull())
-                item.pixmap = ":/img/not_available.png";
-            else
-                item.pixmap = Pics::toBase64(pix);
+            mPaths.insert(item.path);
+            added += item;
         }
-
-        loaded.append(item);
     }
 
-    return true;
-}
-
-// TODO add QDir where to save
-bool jpeg::Saver::save(const QList<Photo>& items, qint64 addsecs)
-{
-    errors.clear();
+    if (added.isEmpty())
+        return;
 
-    int i = 0;
-    for (const Photo& item : items)
     {
-        emit progress(i++, items.size());
-
-        if (item.flags.coordGuessed)
-        {
-            Exif::File exif;
-            if (!exif.load(item.path)) {
-                errors.append(tr("Unable to read EXIF from '%1'").arg(item.path));
-                continue;
-            }
-
-            exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE, Exif::Utils::toDMS(item.lat()));
-            exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE_REF, Exif::Utils::toLatitudeRef(item.lat()));
-            exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE, Exif::Utils::toDMS(item.lon()));
-            exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LONGITUDE_REF, Exif::Utils::toLongitudeRef(item.lon()));
-            exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE, Exif::Utils::toSingleRational(item.altitude));
-            exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::ALTITUDE_REF, Exif::Utils::toAltitudeRef(item.altitude));
-
-            if (addsecs && item.time.isValid()) {
-                const QString pattern = "yyyy:MM:dd hh:mm:ss";
-                const QByteArray timeString = item.time.addSecs(addsecs).toString(pattern).toLatin1();
-                exif.setValue(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL, timeString);
-                exif.setValue(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZED, timeString);
-            }
-
-            // TODO save as
-            if (!exif.save(item.path)) {
-                errors.append(tr("Unable to save EXIF to '%1'").arg(item.path));
-                continue;
-            }
+        QWriteLocker lock(&mThumbnailsLock);
+        for (jpeg::Photo& item: added) {
+            mThumbnails.insert(item.path, item.thumbnail);
+            item.thumbnail = {};
         }
     }
 
-    return errors.isEmpty();
-}
-
+    // photos arrive in batches from the loader, insert each batch at once
+    const int first = rowCount();
+    beginInsertRows({}, first, first + added.size() - 1);
+    mPhotos += added;
+    mMatches.resize(mPhotos.size());
+    endInsertRows();
 
-Model::Model()
-{
-    connect(this, &Model::rowsInserted, this, &Model::guessPhotoCoordinates);
-    connect(this, &Model::dataChanged, this, &Model::guessPhotoCoordinates);
-    connect(this, &Model::trackChanged, this, &Model::guessPhotoCoordinates);
+    // the rows there before keep their positions
+    updatePhotoCoordinates(true, first);
 }
 
-void Model::setTrack(const GPX::Track& track)
+/// shifts photo times by \a timeAdjust seconds and moves the guessed positions accordingly;
+/// only photos leaving their track interval are searched for again
+void Model::setTimeAdjust(qint64 timeAdjust)
 {
-    mTrack.clear();
-    mPath.clearPath();
+    if (timeAdjust == mTimeAdjust)
+        return;
 
-    for (const auto& segment: track)
-        mTrack.append(segment);
+    mTimeAdjust = timeAdjust;
 
-    for (const auto& point: mTrack)
-        mPath.addCoordinate(point.coordinate());
+    if (!mPhotos.isEmpty())
+        emit dataChanged(index(0, Column::Time), index(rowCount() - 1, Column::Time), { Qt::DisplayRole });
 
-    emit trackChanged(Reason::Set);
-}
-
-void Model::add(const QList<jpeg::Photo> photos)
-{
-    QSet<QString> existing;
-    for (const jpeg::Photo& item: qAsConst(mPhotos))
-        existing.insert(item.path);
-
-    for (const jpeg::Photo& item: qAsConst(photos))
-    {
-        if (!existing.contains(item.path))
-        {
-            existing.insert(item.path);
-
-            beginInsertRows({}, rowCount(), rowCount());
-            mPhotos += item;
-            endInsertRows();
-        }
-    }
+    updatePhotoCoordinates(false);
 }
 
 void Model::setCenter(const QGeoCoordinate& center)
@@ -255,6 +107,35 @@ void Model::setZoom(qreal zoom)
     }
 }
 
+void Model::setMapZoom(qreal zoom)
+{
+    mMapZoom = zoom;
+    updatePath();
+}
+
+/// shows the pyramid level matching the map zoom, if it differs from the shown one
+void Model::updatePath()
+{
+    // the polyline is tessellated on every map move, so keep it bounded whatever the track size is
+    static const int MaxPoints = 20000;
+
+    const int level = mPyramid.level(mMapZoom, MaxPoints);
+    if (level == mLevel)
+        return;
+
+    mLevel = level;
+    const GPX::TrackStore& track = mMatcher.track();
+
+    QList<QGeoCoordinate> path;
+    const QVector<int> points = mPyramid.points(level);
+    path.reserve(points.size());
+    for (int i: points)
+        path.append(QGeoCoordinate(track.latitude(i), track.longitude(i)));
+    mPath.setPath(path);
+
+    emit pathChanged();
+}
+
 void Model::remove(const QModelIndexList& indexes)
 {
     QList<QPersistentModelIndex> persistent;
@@ -265,20 +146,68 @@ void Model::remove(const QModelIndexList& indexes)
         if (i.isValid() && i.row() < rowCount())
         {
             beginRemoveRows({}, i.row(), i.row());
+            {
+                QWriteLocker lock(&mThumbnailsLock);
+                mThumbnails.remove(mPhotos[i.row()].path);
+            }
+            mPaths.remove(mPhotos[i.row()].path);
             mPhotos.removeAt(i.row());
+            mMatches.removeAt(i.row());
             endRemoveRows();
         }
     }
 }
 
+/// removes the photos of \a paths, e.g. the files deleted or changed on disk
+void Model::removeFiles(const QSet<QString>& paths)
+{
+    // from the end, so the rows to remove are not moved, adjacent ones at once
+    for (int last = mPhotos.size() - 1; last >= 0; )
+    {
+        if (!paths.contains(mPhotos[last].path))
+        {
+            --last;
+            continue;
+        }
+
+        int first = last;
+        while (first > 0 && paths.contains(mPhotos[first - 1].path))
+            --first;
+
+        beginRemoveRows({}, first, last);
+        {
+            QWriteLocker lock(&mThumbnailsLock);
+            for (int row = first; row <= last; ++row)
+                mThumbnails.remove(mPhotos[row].path);
+        }
+        for (int row = first; row <= last; ++row)
+            mPaths.remove(mPhotos[row].path);
+        mPhotos.erase(mPhotos.begin() + first, mPhotos.begin() + last + 1);
+        mMatches.remove(first, last - first + 1);
+        endRemoveRows();
+
+        last = first - 1;
+    }
+}
+
 void Model::clear()
 {
-    mTrack.clear();
+    mMatcher.clear();
+    mPyramid = {};
+    ++mPyramidId;
+    mLevel = -1;
     mPath.clearPath();
+    emit pathChanged();
     emit trackChanged(Reason::Clear);
 
     beginResetModel();
     mPhotos.clear();
+    mPaths.clear();
+    mMatches.clear();
+    {
+        QWriteLocker lock(&mThumbnailsLock);
+        mThumbnails.clear();
+    }
     endResetModel();
 }
 
@@ -369,41 +298,102 @@ QVariant Model::data(const QModelIndex &index, int role) const
     if (role == Role::Longitude)
         return item.lon();
 
-    if (role == Role::Pixmap)
-        return item.pixmap;
+    if (role == Role::Pixmap) // the modification time makes a file loaded again a new image for the QML cache
+        return QString("image://%1/%2/%3").arg(ThumbnailProvider::Name, QString::fromLatin1(item.path.toUtf8().toHex()))
+                                          .arg(item.fileModified);
 
     return {};
 }
 
 void Model::guessPhotoCoordinates()
 {
-    if (mTrack.isEmpty() || mPhotos.isEmpty()) return;
+    updatePhotoCoordinates(true);
+}
 
-    beginResetModel();
-    for (auto& item: mPhotos)
+/// \param rematch     search the track for every photo, otherwise reuse the intervals found last time
+/// \param first       the first row to update, the rows before it are left as they are
+void Model::updatePhotoCoordinates(bool rematch, int first)
+{
+    if (mMatcher.isEmpty() || mPhotos.isEmpty()) return;
+
+    QVector<int> changed;
+    auto update = [this, rematch, &changed](int row, const GPX::Matcher::Match& match, qint64 time) {
+        jpeg::Photo& item = mPhotos[row];
+        const QPointF previous = item.position;
+
+        mMatches[row] = match;
+        if (match.isValid()) {
+            item.setPosition(mMatcher.position(match, time));
+            item.flags.coordGuessed = true;
+        } else {
+            if (rematch || item.flags.coordGuessed)
+                qWarning() << item.name << item.time.addSecs(mTimeAdjust) << "is beyond track time";
+            // clear position if guessed earlier
+            item.position = {};
+            item.flags.coordGuessed = false;
+        }
+
+        if (item.position != previous)
+            changed.append(row);
+    };
+
+    QVector<int> rows;
+    QVector<qint64> times;
+    for (int row = first; row < mPhotos.size(); ++row)
     {
+        const jpeg::Photo& item = mPhotos[row];
         if (item.time.isNull() || item.flags.haveGPSCoord)
             continue;
 
-        auto i = std::find_if(mTrack.begin(), mTrack.end(), [time = item.time.addSecs(mTimeAdjust)](const QGeoPositionInfo& info) {
-            return info.timestamp() > time; });
-        if (i == mTrack.begin() || i == mTrack.end()) {
-            qWarning() << item.name << item.time.addSecs(mTimeAdjust) << "is beyond track time";
-            // clear position if guessed earlier
-            item.position = {};
-            item.flags.coordGuessed = false;
+        const qint64 time = item.time.addSecs(mTimeAdjust).toMSecsSinceEpoch();
+        if (!rematch && mMatcher.contains(mMatches[row], time)) {
+            // same interval, just move along it
+            update(row, mMatches[row], time);
             continue;
         }
-        const QGeoPositionInfo& after = *i;
-        const QGeoPositionInfo& before = *(--i);
-//        qDebug().noquote() << item.baseName << "found" <<
-//                              before.timestamp().time().toString() <<
-//                              item.time.time().toString() <<
-//                              after.timestamp().time().toString();
-        item.setPosition(GPX::interpolated(before, after, item.time.addSecs(mTimeAdjust)));
-        item.flags.coordGuessed = true;
+
+        rows.append(row);
+        times.append(time);
     }
-    endResetModel();
+
+    // photos are usually sorted by name and so by time, then it's a single pass over the track
+    const QVector<GPX::Matcher::Match> matches = mMatcher.find(times);
+    for (int i = 0; i < rows.size(); ++i)
+        update(rows[i], matches[i], times[i]);
+
+    std::sort(changed.begin(), changed.end());
+    emitPositionChanged(changed);
+}
+
+/// notifies about the changed position of each contiguous range of \a rows,
+/// so the views update the existing items instead of recreating them all
+void Model::emitPositionChanged(const QVector<int>& rows)
+{
+    const QVector<int> roles = { Qt::DisplayRole, Role::Latitude, Role::Longitude };
+
+    for (int i = 0; i < rows.size(); )
+    {
+        int last = i;
+        while (last + 1 < rows.size() && rows[last + 1] == rows[last] + 1)
+            ++last;
+
+        emit dataChanged(index(rows[i], 0), index(rows[last], Column::Count - 1), roles);
+        i = last + 1;
+    }
+}
+
+/// \a id is the one returned for Role::Pixmap, thread-safe
+QImage Model::thumbnail(const QString& id) const
+{
+    // "<hex path>/<modified>"
+    return thumbnailOf(QString::fromUtf8(QByteArray::fromHex(id.section('/', 0, 0).toLatin1())));
+}
+
+/// thread-safe
+QImage Model::thumbnailOf(const QString& path) const
+{
+    QReadLocker lock(&mThumbnailsLock);
+    return mThumbnails.value(path);
 }
 
 QString Model::tooltip(const jpeg::Photo& item)
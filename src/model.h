@@ -6,67 +6,20 @@
 #include <QDateTime>
 #include <QGeoCoordinate>
 #include <QGeoPath>
-#include <QGeoPositionInfo>
-#include <QPixmap>
+#include <QHash>
+#include <QImage>
 #include <QPointF>
 #include <QQmlEngine>
+#include <QReadWriteLock>
+#include <QSet>
 #include <QString>
+#include <QThreadPool>
 
-#include "gpx/track.h"
+#include "gpx/matcher.h"
+#include "gpx/pyramid.h"
 #include "gpx/statistic.h"
-
-namespace jpeg
-{
-
-struct Photo
-{
-    QString path;
-    QString name;
-    QDateTime time; // shot time from EXIF or last modified
-    QPointF position;
-    double altitude = 0.;
-    QString pixmap; // base64 thumbnail
-    struct Flags
-    {
-        Flags() { memset(this, 0, sizeof(Flags)); }
-
-        uint8_t haveShotTime : 1; // have EXIF digitized / original timestamp in the file
-        uint8_t haveGPSCoord : 1; // have EXIF GPS position tags in the file
-        uint8_t coordGuessed : 1; // position guessed from time and track
-    } flags;
-
-    double lat() const { return position.x(); }
-    double lon() const { return position.y(); }
-    void setPosition(const QGeoCoordinate& coord);
-};
-
-
-class FileProcessor : public QObject
-{
-    Q_OBJECT
-
-signals:
-    void progress(int i, int total);
-
-public:
-    QStringList errors;
-};
-
-struct Loader : FileProcessor
-{
-    bool load(const QStringList& fileNames);
-
-    QList<Photo> loaded;
-    Statistic statistic;
-};
-
-struct Saver : FileProcessor
-{
-    bool save(const QList<Photo>& items, qint64 addsecs);
-};
-
-} // namespace jpeg
-
+#include "gpx/track.h"
+#include "jpeg/photo.h"
 
 class Model : public QAbstractListModel
 {
@@ -76,13 +29,14 @@ class Model : public QAbstractListModel
 #endif
 
     // TODO extract?
-    Q_PROPERTY(QGeoPath path MEMBER mPath NOTIFY trackChanged)
+    Q_PROPERTY(QGeoPath path MEMBER mPath NOTIFY pathChanged)
     Q_PROPERTY(QGeoCoordinate center MEMBER mCenter WRITE setCenter NOTIFY centerChanged)
     Q_PROPERTY(qreal zoom MEMBER mZoom WRITE setZoom NOTIFY zoomChanged)
 
 
 signals:
     void trackChanged(int reason);
+    void pathChanged();
     void centerChanged();
     void zoomChanged();
 
@@ -93,20 +47,28 @@ public:
 
     explicit Model(); // QML-used objects must be destoyed after QML engine so don't pass parent here
 
-    void setTrack(const GPX::Track& track);
+    void setTrack(const GPX::TrackStore& track);
     void setCenter(const QGeoCoordinate& center);
     void setZoom(qreal zoom);
+    QGeoCoordinate center() const { return mCenter; }
+    qreal zoom() const { return mZoom; }
+
+    /// the zoom level the map shows the track at, the path is simplified accordingly
+    Q_INVOKABLE void setMapZoom(qreal zoom);
 
     void add(const QList<jpeg::Photo> photos);
     void remove(const QModelIndexList& indexes);
+    void removeFiles(const QSet<QString>& paths);
 
     void clear();
 
-    void setTimeAdjust(qint64 timeAdjust) { mTimeAdjust = timeAdjust; }
+    void setTimeAdjust(qint64 timeAdjust);
     qint64 timeAdjust() const { return mTimeAdjust; }
 
     const QList<jpeg::Photo>& photos() const { return mPhotos; }
-    const QList<QGeoPositionInfo>& track() const { return mTrack; }
+    QImage thumbnail(const QString& id) const;
+    QImage thumbnailOf(const QString& path) const;
+    const GPX::TrackStore& track() const { return mMatcher.track(); }
 
     QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
     int rowCount(const QModelIndex &parent = QModelIndex()) const override;
@@ -122,14 +84,30 @@ public:
 private:
     static QString tooltip(const jpeg::Photo& item);
 
+    void updatePhotoCoordinates(bool rematch, int first = 0);
+    void emitPositionChanged(const QVector<int>& rows);
+    void updatePath();
+
     QList<jpeg::Photo> mPhotos;
+    QSet<QString> mPaths; // of mPhotos, the ones added again are skipped
+    QVector<GPX::Matcher::Match> mMatches; // the track interval of each photo found last time
+
+    // thumbnails are kept apart from the photos and served by ThumbnailProvider, maybe from another thread
+    QHash<QString, QImage> mThumbnails; // by path
+    mutable QReadWriteLock mThumbnailsLock;
     qint64 mTimeAdjust = 0; // photo timestamp adjustment, seconds
 
-    QList<QGeoPositionInfo> mTrack;
+    GPX::Matcher mMatcher;
+    GPX::Pyramid mPyramid;
+    int mPyramidId = 0; // the track the pyramid being built is for
+    int mLevel = -1;    // of the pyramid shown as mPath
+    qreal mMapZoom = 3;
     QGeoPath mPath;
     QGeoCoordinate mCenter;
     qreal mZoom = 3;
 
+    QThreadPool mPyramidPool; // last, so its destructor waits for the builder first
+
 };
 
 
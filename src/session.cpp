@@ -0,0 +1,416 @@
+#include "session.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <cstring>
+#include <type_traits>
+
+namespace
+{
+
+const quint32 Magic = 0x67747373; // "gtss"
+const quint32 Version = 1;
+const quint32 ByteOrder = 0x01020304; // the snapshot is only read on the machine it's written on
+
+struct StringRef
+{
+    quint32 offset; // in QChars from the start of the strings section
+    quint32 length;
+};
+
+struct Header
+{
+    quint32 magic;
+    quint32 version;
+    quint32 byteOrder;
+    quint32 headerSize;
+    qint64 fileSize; // a truncated file is detected before anything is read
+
+    qint64 timeAdjust;
+    double centerLat;
+    double centerLon;
+    double zoom;
+    StringRef title;
+
+    qint32 points;
+    qint32 segments;
+    qint32 photos;
+    qint32 trackFiles;
+
+    // section offsets from the start of the file, 8-byte aligned
+    qint64 time;
+    qint64 lat;
+    qint64 lon;
+    qint64 alt;
+    qint64 segmentStarts;
+    qint64 photoRecords;
+    qint64 fileRecords;
+    qint64 strings;
+    qint64 thumbnails;
+    qint64 stringsSize;    // QChars
+    qint64 thumbnailsSize; // bytes
+};
+
+enum PhotoFlag : quint8 { HaveShotTime = 1, HaveGPSCoord = 2, HaveTime = 4 };
+
+struct PhotoRecord
+{
+    qint64 fileSize;
+    qint64 fileModified;
+    qint64 time; // wall clock as if it were UTC, see timeSpec
+    double lat;
+    double lon;
+    double altitude;
+    qint64 thumbnail; // offset in the thumbnails section, -1 if none
+    StringRef path;
+    StringRef name;
+    quint16 thumbnailWidth;
+    quint16 thumbnailHeight;
+    quint8 flags;
+    quint8 timeSpec;
+    quint8 reserved[2];
+};
+
+struct FileRecord
+{
+    qint64 size;
+    qint64 modified;
+    StringRef path;
+};
+
+static_assert(std::is_trivially_copyable<Header>::value && std::is_trivially_copyable<PhotoRecord>::value
+              && std::is_trivially_copyable<FileRecord>::value, "the records are written as they are");
+
+/// the sections of the file being written
+class Writer
+{
+    QByteArray mStrings;
+    QByteArray mThumbnails;
+
+public:
+    StringRef add(const QString& string) {
+        const StringRef ref = { static_cast<quint32>(mStrings.size() / sizeof(QChar)), static_cast<quint32>(string.size()) };
+        mStrings.append(reinterpret_cast<const char*>(string.constData()), string.size() * static_cast<int>(sizeof(QChar)));
+        return ref;
+    }
+
+    /// thumbnails are tiny, raw pixels are faster to restore than any image format
+    qint64 add(const QImage& image, PhotoRecord* record) {
+        record->thumbnailWidth = record->thumbnailHeight = 0;
+        if (image.isNull() || image.width() > 0xFFFF || image.height() > 0xFFFF)
+            return -1;
+
+        const QImage rgb = image.convertToFormat(QImage::Format_RGB888);
+        const qint64 offset = mThumbnails.size();
+        for (int y = 0; y < rgb.height(); ++y)
+            mThumbnails.append(reinterpret_cast<const char*>(rgb.constScanLine(y)), rgb.width() * 3);
+
+        record->thumbnailWidth = static_cast<quint16>(rgb.width());
+        record->thumbnailHeight = static_cast<quint16>(rgb.height());
+        return offset;
+    }
+
+    const QByteArray& strings() const { return mStrings; }
+    const QByteArray& thumbnails() const { return mThumbnails; }
+};
+
+template <typename T>
+QByteArray bytes(const QVector<T>& vector)
+{
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(vector.constData()), vector.size() * static_cast<int>(sizeof(T)));
+}
+
+template <typename T>
+QVector<T> array(const uchar* data, qint64 offset, int count)
+{
+    QVector<T> array(count);
+    if (count)
+        std::memcpy(array.data(), data + offset, count * sizeof(T));
+    return array;
+}
+
+} // namespace
+
+Session::File Session::File::stat(const QString& path)
+{
+    const QFileInfo info(path);
+
+    File file;
+    file.path = info.absoluteFilePath();
+    file.size = info.size();
+    file.modified = info.lastModified().toMSecsSinceEpoch();
+    return file;
+}
+
+bool Session::File::isChanged() const
+{
+    const QFileInfo info(path);
+    return !info.exists() || info.size() != size || info.lastModified().toMSecsSinceEpoch() != modified;
+}
+
+QString Session::defaultFileName()
+{
+    return QDir(QStandardPaths::writableLocation(QStandardPaths::AppDataLocation)).absoluteFilePath("session.bin");
+}
+
+bool Session::fail(const QString& message) const
+{
+    mErrorString = QString("%1: %2").arg(mFileName, message);
+    qWarning().noquote() << "Session:" << mErrorString;
+    return false;
+}
+
+bool Session::save() const
+{
+    Writer writer;
+    Header header = {};
+    header.magic = Magic;
+    header.version = Version;
+    header.byteOrder = ByteOrder;
+    header.headerSize = sizeof(Header);
+    header.timeAdjust = timeAdjust;
+    header.centerLat = center.isValid() ? center.latitude() : qQNaN();
+    header.centerLon = center.isValid() ? center.longitude() : qQNaN();
+    header.zoom = zoom;
+    header.title = writer.add(title);
+    header.points = track.size();
+    header.photos = photos.size();
+    header.trackFiles = trackFiles.size();
+
+    // the empty segments are of no use, without them load() checks the starts are strictly ascending
+    QVector<int> segmentStarts;
+    for (int segment = 0; segment < track.segmentCount(); ++segment)
+        if (track.segmentBegin(segment) < track.segmentEnd(segment))
+            segmentStarts.append(track.segmentBegin(segment));
+    header.segments = segmentStarts.size();
+
+    QVector<PhotoRecord> photoRecords(photos.size());
+    for (int i = 0; i < photos.size(); ++i)
+    {
+        const jpeg::Photo& photo = photos[i];
+        PhotoRecord& record = photoRecords[i];
+        std::memset(&record, 0, sizeof(record));
+
+        record.fileSize = photo.fileSize;
+        record.fileModified = photo.fileModified;
+        if (!photo.time.isNull()) {
+            record.time = QDateTime(photo.time.date(), photo.time.time(), Qt::UTC).toMSecsSinceEpoch();
+            record.timeSpec = static_cast<quint8>(photo.time.timeSpec());
+            record.flags |= HaveTime;
+        }
+
+        // a guessed position depends on the track and the time adjustment, it's guessed again on restore
+        if (photo.flags.haveGPSCoord) {
+            record.lat = photo.lat();
+            record.lon = photo.lon();
+            record.altitude = photo.altitude;
+            record.flags |= HaveGPSCoord;
+        }
+        if (photo.flags.haveShotTime)
+            record.flags |= HaveShotTime;
+
+        record.path = writer.add(photo.path);
+        record.name = writer.add(photo.name);
+        record.thumbnail = writer.add(photo.thumbnail, &record);
+    }
+
+    QVector<FileRecord> fileRecords(trackFiles.size());
+    for (int i = 0; i < trackFiles.size(); ++i)
+    {
+        std::memset(&fileRecords[i], 0, sizeof(FileRecord));
+        fileRecords[i].size = trackFiles[i].size;
+        fileRecords[i].modified = trackFiles[i].modified;
+        fileRecords[i].path = writer.add(trackFiles[i].path);
+    }
+
+    // the sections in the order of the offsets in the header
+    const QList<QPair<qint64*, QByteArray>> sections = {
+        { &header.time,          bytes(track.times()) },
+        { &header.lat,           bytes(track.latitudes()) },
+        { &header.lon,           bytes(track.longitudes()) },
+        { &header.alt,           bytes(track.altitudes()) },
+        { &header.segmentStarts, bytes(segmentStarts) },
+        { &header.photoRecords,  bytes(photoRecords) },
+        { &header.fileRecords,   bytes(fileRecords) },
+        { &header.strings,       writer.strings() },
+        { &header.thumbnails,    writer.thumbnails() },
+    };
+    header.stringsSize = writer.strings().size() / static_cast<int>(sizeof(QChar));
+    header.thumbnailsSize = writer.thumbnails().size();
+
+    auto aligned = [](qint64 offset) { return (offset + 7) & ~qint64(7); };
+    qint64 offset = sizeof(Header);
+    for (const auto& section: sections) {
+        offset = aligned(offset);
+        *section.first = offset;
+        offset += section.second.size();
+    }
+    header.fileSize = offset;
+
+    QDir().mkpath(QFileInfo(mFileName).absolutePath());
+
+    QSaveFile file(mFileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return fail(file.errorString());
+
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (const auto& section: sections) {
+        file.write(QByteArray(static_cast<int>(*section.first - file.pos()), '\0'));
+        file.write(section.second);
+    }
+
+    if (!file.commit())
+        return fail(file.errorString());
+
+    qInfo() << "Session:" << photos.size() << "photo(s) and" << track.size() << "track point(s) saved to" << mFileName;
+    return true;
+}
+
+bool Session::load()
+{
+    QFile file(mFileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return fail(file.errorString());
+
+    const qint64 size = file.size();
+    if (size < static_cast<qint64>(sizeof(Header)))
+        return fail("too short");
+
+    const uchar* data = file.map(0, size);
+    if (!data)
+        return fail(file.errorString());
+
+    Header header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.magic != Magic || header.version != Version || header.byteOrder != ByteOrder || header.headerSize != sizeof(Header))
+        return fail("unsupported format");
+    if (header.fileSize != size)
+        return fail("truncated");
+
+    auto fits = [size](qint64 offset, qint64 count, qint64 itemSize) {
+        return offset >= 0 && count >= 0 && offset <= size && count <= (size - offset) / itemSize;
+    };
+    if (!fits(header.time, header.points, sizeof(qint64)) ||
+        !fits(header.lat, header.points, sizeof(double)) ||
+        !fits(header.lon, header.points, sizeof(double)) ||
+        !fits(header.alt, header.points, sizeof(double)) ||
+        !fits(header.segmentStarts, header.segments, sizeof(qint32)) ||
+        !fits(header.photoRecords, header.photos, sizeof(PhotoRecord)) ||
+        !fits(header.fileRecords, header.trackFiles, sizeof(FileRecord)) ||
+        !fits(header.strings, header.stringsSize, sizeof(QChar)) ||
+        !fits(header.thumbnails, header.thumbnailsSize, 1))
+        return fail("corrupted");
+
+    const QChar* strings = reinterpret_cast<const QChar*>(data + header.strings);
+    auto string = [&header, strings](const StringRef& ref, QString* out) {
+        if (ref.offset > header.stringsSize || ref.length > header.stringsSize - ref.offset)
+            return false;
+        *out = QString(strings + ref.offset, static_cast<int>(ref.length));
+        return true;
+    };
+
+    if (!string(header.title, &title))
+        return fail("corrupted");
+
+    // TrackStore indexes the points by the segment starts as they are
+    const QVector<int> segmentStarts = array<int>(data, header.segmentStarts, header.segments);
+    for (int segment = 0; segment < segmentStarts.size(); ++segment)
+    {
+        const int start = segmentStarts[segment];
+        const bool ascending = segment == 0 ? start == 0 : start > segmentStarts[segment - 1];
+        if (!ascending || start >= header.points)
+            return fail("corrupted");
+    }
+
+    track.assign(array<qint64>(data, header.time, header.points),
+                 array<double>(data, header.lat, header.points),
+                 array<double>(data, header.lon, header.points),
+                 array<double>(data, header.alt, header.points),
+                 segmentStarts);
+
+    trackFiles.clear();
+    const QVector<FileRecord> fileRecords = array<FileRecord>(data, header.fileRecords, header.trackFiles);
+    for (const FileRecord& record: fileRecords)
+    {
+        File trackFile;
+        trackFile.size = record.size;
+        trackFile.modified = record.modified;
+        if (!string(record.path, &trackFile.path))
+            return fail("corrupted");
+        trackFiles.append(trackFile);
+    }
+
+    photos.clear();
+    photos.reserve(header.photos);
+    const PhotoRecord* records = reinterpret_cast<const PhotoRecord*>(data + header.photoRecords);
+    for (int i = 0; i < header.photos; ++i)
+    {
+        PhotoRecord record;
+        std::memcpy(&record, records + i, sizeof(record)); // the mapping may be unaligned for the doubles
+
+        jpeg::Photo photo;
+        if (!string(record.path, &photo.path) || !string(record.name, &photo.name))
+            return fail("corrupted");
+
+        photo.fileSize = record.fileSize;
+        photo.fileModified = record.fileModified;
+        if (record.flags & HaveTime) {
+            photo.time = QDateTime::fromMSecsSinceEpoch(record.time, Qt::UTC);
+            photo.time.setTimeSpec(static_cast<Qt::TimeSpec>(record.timeSpec));
+        }
+        photo.flags.haveShotTime = (record.flags & HaveShotTime) != 0;
+        photo.flags.haveGPSCoord = (record.flags & HaveGPSCoord) != 0;
+        if (photo.flags.haveGPSCoord) {
+            photo.position = QPointF(record.lat, record.lon);
+            photo.altitude = record.altitude;
+        }
+
+        const qint64 thumbnailSize = qint64(record.thumbnailWidth) * record.thumbnailHeight * 3;
+        if (record.thumbnail >= 0 && thumbnailSize > 0 && record.thumbnail <= header.thumbnailsSize - thumbnailSize)
+        {
+            const uchar* pixels = data + header.thumbnails + record.thumbnail;
+            photo.thumbnail = QImage(record.thumbnailWidth, record.thumbnailHeight, QImage::Format_RGB888);
+            for (int y = 0; y < record.thumbnailHeight; ++y)
+                std::memcpy(photo.thumbnail.scanLine(y), pixels + y * record.thumbnailWidth * 3, record.thumbnailWidth * 3);
+        }
+
+        photos.append(photo);
+    }
+
+    timeAdjust = header.timeAdjust;
+    center = qIsNaN(header.centerLat) ? QGeoCoordinate() : QGeoCoordinate(header.centerLat, header.centerLon);
+    zoom = header.zoom;
+
+    qInfo() << "Session:" << photos.size() << "photo(s) and" << track.size() << "track point(s) restored from" << mFileName;
+    return true;
+}
+
+bool Session::remove() const
+{
+    return !QFile::exists(mFileName) || QFile::remove(mFileName);
+}
+
+Session::Changes Session::changes() const
+{
+    Changes changes;
+
+    for (const File& file: trackFiles)
+        changes.trackChanged |= file.isChanged();
+
+    for (const jpeg::Photo& photo: photos)
+    {
+        const QFileInfo info(photo.path);
+        if (!info.exists())
+            changes.missingPhotos.append(photo.path);
+        else if (info.size() != photo.fileSize || info.lastModified().toMSecsSinceEpoch() != photo.fileModified)
+            changes.changedPhotos.append(photo.path);
+    }
+
+    return changes;
+}
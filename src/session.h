@@ -0,0 +1,67 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <QGeoCoordinate>
+#include <QList>
+#include <QString>
+#include <QStringList>
+
+#include "gpx/track.h"
+#include "jpeg/photo.h"
+
+/* The state of the last run, restored on startup without parsing anything again.
+   The snapshot is a single binary file of fixed-layout records and arrays in the native
+   byte order; it is mapped into memory on load and the arrays are copied out as they are.
+   The files it was made of are checked later by changes(), in the background. */
+
+class Session
+{
+public:
+    struct File
+    {
+        QString path;
+        qint64 size = 0;
+        qint64 modified = 0; // msecs since epoch
+
+        static File stat(const QString& path);
+        bool isChanged() const; // compared to the file on disk
+    };
+
+    struct Changes
+    {
+        QStringList changedPhotos; // to load again
+        QStringList missingPhotos; // to remove
+        bool trackChanged = false;
+
+        bool isEmpty() const { return changedPhotos.isEmpty() && missingPhotos.isEmpty() && !trackChanged; }
+    };
+
+    static QString defaultFileName();
+
+    explicit Session(const QString& fileName = defaultFileName()) : mFileName(fileName) {}
+
+    bool load();
+    bool save() const;
+    bool remove() const;
+
+    /// stats every file of the session, so run it in a worker thread
+    Changes changes() const;
+
+    const QString& errorString() const { return mErrorString; }
+
+    QList<File> trackFiles;
+    QString title;
+    GPX::TrackStore track;
+    QList<jpeg::Photo> photos; // with thumbnails
+    qint64 timeAdjust = 0;
+    QGeoCoordinate center;
+    qreal zoom = 0;
+
+private:
+    bool fail(const QString& message) const;
+
+    const QString mFileName;
+    mutable QString mErrorString;
+};
+
+#endif // SESSION_H
@@ -0,0 +1,99 @@
+#include "spatialindex.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+/// spreads the bits of \a value out to the even bits of the result
+quint64 SpatialIndex::spread(quint32 value)
+{
+    quint64 x = value;
+    x = (x | (x << 16)) & 0x0000FFFF0000FFFFull;
+    x = (x | (x << 8))  & 0x00FF00FF00FF00FFull;
+    x = (x | (x << 4))  & 0x0F0F0F0F0F0F0F0Full;
+    x = (x | (x << 2))  & 0x3333333333333333ull;
+    x = (x | (x << 1))  & 0x5555555555555555ull;
+    return x;
+}
+
+quint64 SpatialIndex::code(const QPointF& point)
+{
+    const double cells = 1u << Depth;
+    const quint32 x = static_cast<quint32>(qBound(0., point.x() * cells, cells - 1));
+    const quint32 y = static_cast<quint32>(qBound(0., point.y() * cells, cells - 1));
+    return spread(x) | (spread(y) << 1);
+}
+
+void SpatialIndex::build(const QVector<QPointF>& points, const QVector<int>& ids)
+{
+    Q_ASSERT(points.size() == ids.size());
+
+    clear();
+
+    QVector<quint64> codes(points.size());
+    for (int i = 0; i < points.size(); ++i)
+        codes[i] = code(points[i]);
+
+    QVector<int> order(points.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&codes](int a, int b) { return codes[a] < codes[b]; });
+
+    mCodes.reserve(points.size());
+    mIds.reserve(points.size());
+    mSumX.reserve(points.size() + 1);
+    mSumY.reserve(points.size() + 1);
+    mSumX.append(0.);
+    mSumY.append(0.);
+    for (int i: qAsConst(order))
+    {
+        mCodes.append(codes[i]);
+        mIds.append(ids[i]);
+        mSumX.append(mSumX.last() + points[i].x());
+        mSumY.append(mSumY.last() + points[i].y());
+    }
+}
+
+void SpatialIndex::clear()
+{
+    mCodes.clear();
+    mIds.clear();
+    mSumX.clear();
+    mSumY.clear();
+}
+
+QVector<SpatialIndex::Cell> SpatialIndex::cells(const QRectF& rect, int level) const
+{
+    QVector<Cell> cells;
+    if (mCodes.isEmpty())
+        return cells;
+
+    // a rect without a position is the whole world rather than an arbitrary cell
+    const bool finite = std::isfinite(rect.left()) && std::isfinite(rect.right()) &&
+                        std::isfinite(rect.top()) && std::isfinite(rect.bottom());
+    const QRectF area = finite ? rect : QRectF(0, 0, 1, 1);
+
+    level = qBound(0, level, Depth);
+    const int count = 1 << level; // per axis
+    auto cell = [count](double coordinate) { return static_cast<int>(qBound(0., coordinate * count, count - 1.)); };
+
+    const int shift = 2 * (Depth - level);
+    for (int y = cell(area.top()); y <= cell(area.bottom()); ++y)
+    {
+        for (int x = cell(area.left()); x <= cell(area.right()); ++x)
+        {
+            const quint64 prefix = spread(static_cast<quint32>(x)) | (spread(static_cast<quint32>(y)) << 1);
+            const auto begin = std::lower_bound(mCodes.cbegin(), mCodes.cend(), prefix << shift);
+            const auto end = std::lower_bound(begin, mCodes.cend(), (prefix + 1) << shift);
+            if (begin == end)
+                continue;
+
+            Cell found;
+            found.begin = static_cast<int>(begin - mCodes.cbegin());
+            found.end = static_cast<int>(end - mCodes.cbegin());
+            found.center = QPointF(mSumX[found.end] - mSumX[found.begin], mSumY[found.end] - mSumY[found.begin]) / found.size();
+            cells.append(found);
+        }
+    }
+
+    return cells;
+}
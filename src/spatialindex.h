@@ -0,0 +1,50 @@
+#ifndef SPATIALINDEX_H
+#define SPATIALINDEX_H
+
+#include <QPointF>
+#include <QRectF>
+#include <QVector>
+
+/* Linear quadtree over points of the unit square (e.g. Web Mercator):
+   the points are sorted by their Z-order code, so every quadtree cell of any level
+   is a contiguous range found with two binary searches, and prefix sums give
+   the mean point of a cell without visiting its points. */
+
+class SpatialIndex
+{
+public:
+    static const int Depth = 30; // bits per axis, the deepest cell level
+
+    struct Cell
+    {
+        int begin = 0; // first entry, see id()
+        int end = 0;
+        QPointF center; // mean of the points
+
+        int size() const { return end - begin; }
+    };
+
+    /// indexes \a points, \a ids are reported back for them
+    void build(const QVector<QPointF>& points, const QVector<int>& ids);
+    void clear();
+
+    bool isEmpty() const { return mCodes.isEmpty(); }
+    int size() const { return mCodes.size(); }
+
+    /// non-empty cells of \a level intersecting \a rect; a cell of level l is 2^-l wide,
+    /// so the caller picks the level to get a sensible number of cells
+    QVector<Cell> cells(const QRectF& rect, int level) const;
+
+    int id(int entry) const { return mIds[entry]; }
+
+private:
+    static quint64 spread(quint32 value);
+    static quint64 code(const QPointF& point);
+
+    QVector<quint64> mCodes; // ascending
+    QVector<int> mIds;
+    QVector<double> mSumX;   // prefix sums, one longer than mCodes
+    QVector<double> mSumY;
+};
+
+#endif // SPATIALINDEX_H
@@ -0,0 +1,27 @@
+#ifndef TASK_H
+#define TASK_H
+
+#include <QRunnable>
+#include <QThreadPool>
+
+#include <utility>
+
+/* QThreadPool::start(std::function) is 5.15+, so here is a portable one */
+
+template <class Function>
+class Task : public QRunnable
+{
+    Function mFunction;
+
+public:
+    explicit Task(Function function) : mFunction(std::move(function)) {}
+    void run() override { mFunction(); }
+};
+
+template <class Function>
+void run(QThreadPool* pool, Function function, int priority = 0)
+{
+    pool->start(new Task<Function>(std::move(function)), priority);
+}
+
+#endif // TASK_H
@@ -0,0 +1,332 @@
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#include <QBuffer>
+#include <QDir>
+#include <QTemporaryFile>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+#endif
+
+#include "gpx/decompressor.h"
+#include "gpx/loader.h"
+#include "gpx/parser.h"
+#include "gpx/trackreader.h"
+
+namespace
+{
+
+bool parseTime(const char* s, qint64* msecs)
+{
+    return GPX::Parser::parseTime(s, s + strlen(s), msecs);
+}
+
+GPX::Parser::Result parse(const QByteArray& document, GPX::TrackStore* track, QString* name)
+{
+    Statistic statistic;
+    GPX::Parser parser(track, &statistic, name);
+    return parser.parse(document.constData(), document.constData() + document.size());
+}
+
+bool load(const QByteArray& document, GPX::Loader* loader)
+{
+    QTemporaryFile file(QDir::temp().filePath("XXXXXX.gpx"));
+    if (!file.open() || file.write(document) != document.size() || !file.flush())
+        return false;
+    return loader->load(file.fileName());
+}
+
+#ifdef HAVE_ZLIB
+/// a gzip member, as gzip writes it
+QByteArray gzip(const QByteArray& data)
+{
+    z_stream stream = z_stream();
+    if (deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        return {};
+
+    QByteArray compressed(static_cast<int>(deflateBound(&stream, static_cast<uLong>(data.size()))) + 32, '\0');
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.constData()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    const bool ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+    compressed.resize(static_cast<int>(stream.total_out));
+    deflateEnd(&stream);
+    return ok ? compressed : QByteArray();
+}
+#endif
+
+const QByteArray Document =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<gpx version=\"1.1\" xmlns=\"http://www.topografix.com/GPX/1/1\">\n"
+    "<metadata><name>metadata</name></metadata>\n"
+    "<trk><name>Bike &amp; hike</name>\n"
+    "<trkseg>\n"
+    "<trkpt lat=\"55.7512345\" lon='37.6'><ele>120.5</ele><time>2021-07-01T06:58:09Z</time>"
+    "<extensions><time>not a time</time></extensions></trkpt>\n"
+    "<!-- paused -->\n"
+    "<trkpt lon=\"37.61\" lat=\"55.76\"><time>2021-07-01T06:58:10.250Z</time></trkpt>\n"
+    "</trkseg>\n"
+    "<trkseg><trkpt lat=\"-1\" lon=\"-2\"><time>2021-07-01T09:58:11+03:00</time></trkpt></trkseg>\n"
+    "</trk>\n"
+    "<wpt lat=\"1\" lon=\"1\"><time>not a time</time></wpt>\n"
+    "</gpx>\n";
+
+} // namespace
+
+TEST(gpxparser, time)
+{
+    qint64 msecs = 0;
+    EXPECT_TRUE(parseTime("1970-01-01T00:00:00Z", &msecs));
+    EXPECT_EQ(0, msecs);
+    EXPECT_TRUE(parseTime("2021-07-01T06:58:09Z", &msecs));
+    EXPECT_EQ(1625122689000, msecs);
+    EXPECT_TRUE(parseTime("2021-07-01t06:58:09.123z", &msecs));
+    EXPECT_EQ(1625122689123, msecs);
+    EXPECT_TRUE(parseTime("2021-07-01T08:28:09+01:30", &msecs));
+    EXPECT_EQ(1625122689000, msecs);
+    EXPECT_TRUE(parseTime("2021-07-01T05:58:09-0100", &msecs));
+    EXPECT_EQ(1625122689000, msecs);
+    EXPECT_TRUE(parseTime("2020-02-29T00:00:00Z", &msecs));
+    EXPECT_EQ(1582934400000, msecs);
+
+    EXPECT_TRUE(parseTime("2021-07-01T06:58:09", &msecs));
+    EXPECT_EQ(QDateTime(QDate(2021, 7, 1), QTime(6, 58, 9)).toMSecsSinceEpoch(), msecs);
+
+    EXPECT_FALSE(parseTime("2021-02-29T00:00:00Z", &msecs));
+    EXPECT_FALSE(parseTime("2021-13-01T00:00:00Z", &msecs));
+    EXPECT_FALSE(parseTime("2021-07-01 06:58:09Z", &msecs));
+    EXPECT_FALSE(parseTime("2021-07-01T06:58:9Z", &msecs));
+    EXPECT_FALSE(parseTime("2021-07-01T06:58:09.Z", &msecs));
+    EXPECT_FALSE(parseTime("2021-07-01T06:58:09Zx", &msecs));
+}
+
+TEST(gpxparser, document)
+{
+    GPX::TrackStore track;
+    QString name;
+    ASSERT_EQ(GPX::Parser::Parsed, parse(Document, &track, &name));
+
+    EXPECT_EQ(QString("Bike & hike"), name);
+    ASSERT_EQ(3, track.size());
+    ASSERT_EQ(2, track.segmentCount());
+    EXPECT_EQ(2, track.segmentBegin(1));
+
+    EXPECT_EQ(1625122689000, track.msecs(0));
+    EXPECT_DOUBLE_EQ(55.7512345, track.latitude(0));
+    EXPECT_DOUBLE_EQ(37.6, track.longitude(0));
+    EXPECT_DOUBLE_EQ(120.5, track.altitude(0));
+
+    EXPECT_EQ(1625122690250, track.msecs(1));
+    EXPECT_DOUBLE_EQ(55.76, track.latitude(1));
+    EXPECT_TRUE(qIsNaN(track.altitude(1)));
+
+    EXPECT_EQ(1625122691000, track.msecs(2));
+    EXPECT_DOUBLE_EQ(-2., track.longitude(2));
+}
+
+TEST(gpxparser, unsupported)
+{
+    GPX::TrackStore track;
+    QString name;
+    EXPECT_EQ(GPX::Parser::NoTimestamp, parse("<gpx><trk><trkseg><trkpt lat='1' lon='2'/></trkseg></trk></gpx>", &track, &name));
+    EXPECT_EQ(GPX::Parser::Unsupported, parse("<gpx><trk><trkseg><trkpt lat='1' lon='2'>"
+                                              "<time><![CDATA[2021-07-01T06:58:09Z]]></time></trkpt></trkseg></trk></gpx>", &track, &name));
+    EXPECT_EQ(GPX::Parser::Unsupported, parse("<?xml version='1.0' encoding='ISO-8859-1'?><gpx/>", &track, &name));
+    EXPECT_EQ(GPX::Parser::Unsupported, parse("<!DOCTYPE gpx [<!ENTITY e 'x'>]><gpx/>", &track, &name));
+    EXPECT_EQ(GPX::Parser::Unsupported, parse("<gpx><trk><trkseg>", &track, &name));
+}
+
+TEST(gpxparser, fallback_loads_the_same)
+{
+    // the comment inside the value makes the loader read the file with QXmlStreamReader
+    QByteArray fallback = Document;
+    fallback.replace("<ele>120.5</ele>", "<ele>120.5<!-- m --></ele>");
+
+    GPX::Loader fast, slow;
+    ASSERT_TRUE(load(Document, &fast));
+    ASSERT_TRUE(load(fallback, &slow));
+
+    EXPECT_EQ(fast.name(), slow.name());
+    EXPECT_EQ(fast.track().segmentCount(), slow.track().segmentCount());
+    EXPECT_EQ(fast.track().times(), slow.track().times());
+    EXPECT_EQ(fast.track().latitudes(), slow.track().latitudes());
+    EXPECT_EQ(fast.track().longitudes(), slow.track().longitudes());
+    EXPECT_EQ(fast.statistic().total(), slow.statistic().total());
+}
+
+TEST(gpxparser, chunks_load_the_same)
+{
+    QByteArray document = "<gpx><trk><name>chunks</name><trkseg>\n";
+    for (int i = 0; i < 1000; ++i) {
+        if (i == 400)
+            document += "</trkseg><!-- <trkpt lat=\"0\" lon=\"0\"> --><trkseg/><trkseg>\n";
+        document += QString("<trkpt lat=\"%1\" lon=\"%2\"><time>2021-07-01T06:%3:%4Z</time></trkpt>\n")
+                        .arg(50. + i * 1e-4).arg(10. - i * 1e-4).arg(i / 60 % 60, 2, 10, QChar('0')).arg(i % 60, 2, 10, QChar('0'))
+                        .toUtf8();
+    }
+    document += "</trkseg></trk></gpx>\n";
+
+    GPX::Loader whole, chunked;
+    whole.setChunkSize(0);
+    chunked.setChunkSize(document.size() / 16);
+    ASSERT_TRUE(load(document, &whole));
+    ASSERT_TRUE(load(document, &chunked));
+
+    ASSERT_EQ(1000, whole.track().size());
+    EXPECT_EQ(3, whole.track().segmentCount());
+    EXPECT_EQ(whole.name(), chunked.name());
+    EXPECT_EQ(whole.track().segmentCount(), chunked.track().segmentCount());
+    for (int segment = 0; segment < whole.track().segmentCount(); ++segment)
+        EXPECT_EQ(whole.track().segmentBegin(segment), chunked.track().segmentBegin(segment));
+    EXPECT_EQ(whole.track().times(), chunked.track().times());
+    EXPECT_EQ(whole.track().latitudes(), chunked.track().latitudes());
+    EXPECT_EQ(whole.statistic().total(), chunked.statistic().total());
+}
+
+#ifdef HAVE_ZLIB
+TEST(gpxparser, gzip)
+{
+    GPX::Loader plain, compressed;
+    ASSERT_TRUE(load(Document, &plain));
+
+    // two members, the second one begins in the middle of a tag
+    const int half = Document.size() / 2;
+    const QByteArray members = gzip(Document.left(half)) + gzip(Document.mid(half));
+    QBuffer buffer;
+    buffer.setData(members);
+    ASSERT_TRUE(buffer.open(QIODevice::ReadOnly));
+    EXPECT_EQ(GPX::Decompressor::Gzip, GPX::Decompressor::detect(&buffer));
+
+    ASSERT_TRUE(load(members, &compressed)) << qPrintable(compressed.lastError());
+
+    EXPECT_EQ(plain.name(), compressed.name());
+    EXPECT_EQ(plain.track().times(), compressed.track().times());
+    EXPECT_EQ(plain.track().latitudes(), compressed.track().latitudes());
+
+    // broken data is an error, not a shorter track
+    QByteArray truncated = members;
+    truncated.chop(10);
+    EXPECT_FALSE(load(truncated, &compressed));
+}
+
+TEST(gpxparser, empty_gzip)
+{
+    // like an empty .gpx, no points but no error either
+    GPX::Loader loader;
+    EXPECT_TRUE(load(gzip(QByteArray()), &loader)) << qPrintable(loader.lastError());
+    EXPECT_TRUE(loader.track().isEmpty());
+
+    // the stream fails before its first byte
+    const QByteArray header = gzip(Document).left(10);
+    EXPECT_FALSE(load(header, &loader));
+    EXPECT_FALSE(load(header + "\xFF\xFF\xFF\xFF", &loader));
+}
+#endif
+
+TEST(gpxparser, sniffing)
+{
+    // UTF-16 is left to QXmlStreamReader, but it is still told to be GPX
+    QByteArray utf16("\xFF\xFE", 2);
+    for (QChar c: QString::fromUtf8(QByteArray(Document).replace("UTF-8", "UTF-16")))
+        utf16 += QByteArray(1, static_cast<char>(c.unicode() & 0xFF)) + static_cast<char>(c.unicode() >> 8);
+    std::unique_ptr<GPX::Reader> reader = GPX::Reader::create(utf16);
+    ASSERT_TRUE(reader != nullptr);
+    EXPECT_EQ("GPX", reader->format());
+
+    GPX::Loader plain, wide;
+    ASSERT_TRUE(load(Document, &plain));
+    ASSERT_TRUE(load(utf16, &wide)) << qPrintable(wide.lastError());
+    EXPECT_EQ(plain.name(), wide.name());
+    EXPECT_EQ(plain.track().times(), wide.track().times());
+
+    // the internal subset may have '>' in its declarations
+    const QByteArray doctype = "<?xml version=\"1.0\"?>\n"
+                               "<!DOCTYPE gpx [ <!ENTITY who \"<me>\"> <!-- ]> --> ]>\n"
+                               "<gpx version=\"1.1\">";
+    reader = GPX::Reader::create(doctype);
+    ASSERT_TRUE(reader != nullptr);
+    EXPECT_EQ("GPX", reader->format());
+
+    // the root beyond the head, only the name tells
+    const QByteArray comment = "<?xml version=\"1.0\"?>\n<!-- " + QByteArray(8192, '-').replace("--", "- ") + " -->\n<gpx>";
+    EXPECT_TRUE(GPX::Reader::create(comment.left(4096)) == nullptr);
+    reader = GPX::Reader::create(comment.left(4096), "/tmp/track.GPX.gz");
+    ASSERT_TRUE(reader != nullptr);
+    EXPECT_EQ("GPX", reader->format());
+}
+
+TEST(gpxparser, formats)
+{
+    // the same two points in two segments, 55.75/37.6 at 120 m and 55.76/37.61 five seconds later
+    qint64 first = 0;
+    ASSERT_TRUE(parseTime("2021-07-01T06:58:09Z", &first));
+
+    auto nmea = [](const QByteArray& body) {
+        quint8 sum = 0;
+        for (char c: body)
+            sum ^= static_cast<quint8>(c);
+        return "$" + body + "*" + QByteArray::number(sum, 16).rightJustified(2, '0').toUpper() + "\r\n";
+    };
+    const QByteArray nmeaLog =
+        nmea("GPRMC,065809.00,A,5545.000,N,03736.000,E,0.0,0.0,010721,,,A") +
+        nmea("GPGGA,065809.00,5545.000,N,03736.000,E,1,08,1.0,120.0,M,14.0,M,,") +
+        "$GPRMC,065810.00,A,0000.000,N,00000.000,E,0.0,0.0,010721,,,A*00\r\n" +
+        nmea("GPRMC,065812.00,V,,,,,,,010721,,,N") +
+        nmea("GPRMC,065814.00,A,5545.600,N,03736.600,E,0.0,0.0,010721,,,A");
+
+    const QByteArray kml =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+        "<kml xmlns=\"http://www.opengis.net/kml/2.2\" xmlns:gx=\"http://www.google.com/kml/ext/2.2\">"
+        "<Document><name>document</name><Placemark><name>walk</name><gx:MultiTrack>"
+        "<gx:Track><when>2021-07-01T06:58:09Z</when><gx:coord>37.6 55.75 120</gx:coord></gx:Track>"
+        "<gx:Track><when>2021-07-01T06:58:14Z</when><gx:coord>37.61 55.76</gx:coord></gx:Track>"
+        "</gx:MultiTrack></Placemark></Document></kml>\n";
+
+    const QByteArray geoJson =
+        "{\"type\": \"FeatureCollection\", \"features\": [{\"type\": \"Feature\","
+        " \"properties\": {\"name\": \"walk\", \"coordTimes\": [[\"2021-07-01T06:58:09Z\"], [\"2021-07-01T06:58:14Z\"]]},"
+        " \"geometry\": {\"type\": \"MultiLineString\", \"coordinates\": [[[37.6, 55.75, 120]], [[37.61, 55.76]]]}}]}\n";
+
+    // a record with the full timestamp, a timer stop event, a record with a compressed one
+    QByteArray records;
+    auto put = [&records](quint32 value, int size) {
+        for (int i = 0; i < size; ++i)
+            records += static_cast<char>(value >> (8 * i));
+    };
+    auto semicircles = [](double degrees) { return static_cast<quint32>(qRound(degrees * 2147483648.0 / 180)); };
+    const quint32 timestamp = static_cast<quint32>(first / 1000 - 631065600);
+    records += QByteArray("\x40\x00\x00\x14\x00\x04\xFD\x04\x86\x00\x04\x85\x01\x04\x85\x4E\x04\x86", 18);
+    records += '\x00';
+    put(timestamp, 4); put(semicircles(55.75), 4); put(semicircles(37.6), 4); put((120 + 500) * 5, 4);
+    records += QByteArray("\x41\x00\x00\x15\x00\x03\xFD\x04\x86\x00\x01\x00\x01\x01\x00", 15);
+    records += '\x01';
+    put(timestamp + 2, 4); put(0, 1); put(4, 1);
+    records += QByteArray("\x42\x00\x00\x14\x00\x02\x00\x04\x85\x01\x04\x85", 12);
+    records += static_cast<char>(0x80 | 2 << 5 | ((timestamp + 5) & 0x1F));
+    put(semicircles(55.76), 4); put(semicircles(37.61), 4);
+    QByteArray fit("\x0E\x10\x00\x08", 4);
+    for (int i = 0; i < 4; ++i)
+        fit += static_cast<char>(records.size() >> (8 * i));
+    fit += QByteArray(".FIT\x00\x00", 6) + records + QByteArray(2, '\0');
+
+    for (const QByteArray& document: { nmeaLog, kml, geoJson, fit })
+    {
+        GPX::Loader loader;
+        ASSERT_TRUE(load(document, &loader)) << qPrintable(loader.lastError());
+
+        const GPX::TrackStore& track = loader.track();
+        ASSERT_EQ(2, track.size());
+        EXPECT_EQ(2, track.segmentCount());
+        EXPECT_EQ(first, track.msecs(0));
+        EXPECT_EQ(first + 5000, track.msecs(1));
+        EXPECT_NEAR(55.75, track.latitude(0), 1e-6);
+        EXPECT_NEAR(37.6, track.longitude(0), 1e-6);
+        EXPECT_NEAR(120, track.altitude(0), 1e-6);
+        EXPECT_NEAR(55.76, track.latitude(1), 1e-6);
+        EXPECT_NEAR(37.61, track.longitude(1), 1e-6);
+        EXPECT_EQ(2, loader.statistic().total());
+    }
+}
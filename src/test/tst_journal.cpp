@@ -0,0 +1,49 @@
+#include <gtest/gtest.h>
+
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+
+#include "jpeg/journal.h"
+
+TEST(journal, resume)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString fileName = QDir(dir.path()).absoluteFilePath("save.journal");
+
+    // a save writes the first file and is interrupted before the second one
+    {
+        jpeg::Journal journal(fileName);
+        ASSERT_TRUE(journal.open());
+        EXPECT_FALSE(journal.contains("/photos/1.jpg", "55.75 37.6"));
+        ASSERT_TRUE(journal.commit("/photos/1.jpg", "55.75 37.6"));
+    }
+
+    // the crash cut the last line
+    {
+        QFile file(fileName);
+        ASSERT_TRUE(file.open(QIODevice::Append));
+        file.write("0123456789 /photos/2");
+    }
+
+    // the next run skips the file written with the same values only
+    jpeg::Journal journal(fileName);
+    ASSERT_TRUE(journal.open());
+    EXPECT_EQ(1, journal.resumed());
+    EXPECT_TRUE(journal.contains("/photos/1.jpg", "55.75 37.6"));
+    EXPECT_FALSE(journal.contains("/photos/1.jpg", "55.76 37.6"));
+    EXPECT_FALSE(journal.contains("/photos/2.jpg", "55.75 37.6"));
+
+    ASSERT_TRUE(journal.commit("/photos/2.jpg", "55.75 37.6"));
+    {
+        jpeg::Journal again(fileName);
+        ASSERT_TRUE(again.open());
+        EXPECT_EQ(2, again.resumed());
+        EXPECT_TRUE(again.contains("/photos/2.jpg", "55.75 37.6"));
+    }
+
+    // all is saved
+    journal.remove();
+    EXPECT_FALSE(QFile::exists(fileName));
+}
@@ -7,6 +7,7 @@
 #include <gtest/gtest.h>
 
 #include "exif/file.h"
+#include "exif/reader.h"
 #include "exif/utils.h"
 #include "tmpjpegfile.h"
 
@@ -81,3 +82,80 @@ TEST(libexif, replace)
         EXPECT_EQ(replaced, current);
     }
 }
+
+TEST(libexif, save_in_place)
+{
+    QString jpeg = TmpJpegFile::withGps();
+    ASSERT_FALSE(jpeg.isEmpty()) << TmpJpegFile::lastError();
+
+    const auto generated = Exif::Utils::toDMS(12.3456789);
+
+    {
+        // the first save rebuilds the file, reserving some room in the APP1 segment
+        Exif::File exif;
+        ASSERT_TRUE(exif.load(jpeg, false));
+        ASSERT_TRUE(exif.save(jpeg));
+    }
+
+    const qint64 size = QFileInfo(jpeg).size();
+
+    {
+        // the next one keeps the segment length
+        Exif::File exif;
+        ASSERT_TRUE(exif.load(jpeg, false));
+        exif.setValue(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE, generated);
+        ASSERT_TRUE(exif.save(jpeg));
+    }
+
+    EXPECT_EQ(size, QFileInfo(jpeg).size());
+
+    {
+        Exif::File exif;
+        ASSERT_TRUE(exif.load(jpeg, false));
+        auto loaded = exif.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE);
+        ASSERT_EQ(3, loaded.size());
+        EXPECT_EQ(generated[2].numerator, loaded[2].numerator);
+        EXPECT_EQ(generated[2].denominator, loaded[2].denominator);
+    }
+}
+
+TEST(libexif, reader)
+{
+    QString jpeg = TmpJpegFile::withGps();
+    ASSERT_FALSE(jpeg.isEmpty()) << TmpJpegFile::lastError();
+
+    Exif::File file;
+    ASSERT_TRUE(file.load(jpeg, false));
+    Exif::Reader reader;
+    ASSERT_TRUE(reader.load(jpeg));
+
+    for (ExifTag tag: { Exif::Tag::GPS::LATITUDE, Exif::Tag::GPS::LONGITUDE, Exif::Tag::GPS::ALTITUDE })
+    {
+        const auto expected = file.uRationalVector(EXIF_IFD_GPS, tag);
+        const auto loaded = reader.uRationalVector(EXIF_IFD_GPS, tag);
+        ASSERT_FALSE(expected.isEmpty());
+        ASSERT_EQ(expected.size(), loaded.size());
+        for (int i = 0; i < expected.size(); ++i)
+        {
+            EXPECT_EQ(expected[i].numerator, loaded[i].numerator);
+            EXPECT_EQ(expected[i].denominator, loaded[i].denominator);
+        }
+    }
+
+    for (ExifTag tag: { Exif::Tag::GPS::LATITUDE_REF, Exif::Tag::GPS::LONGITUDE_REF, Exif::Tag::GPS::ALTITUDE_REF })
+        EXPECT_EQ(file.ascii(EXIF_IFD_GPS, tag), reader.ascii(EXIF_IFD_GPS, tag));
+
+    EXPECT_EQ(file.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL), reader.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL));
+    EXPECT_EQ(QByteArray("2021:09:09 14:24:46"), reader.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_DIGITIZED));
+
+    const QByteArray thumbnail = reader.thumbnail();
+    ASSERT_FALSE(thumbnail.isEmpty());
+    EXPECT_TRUE(thumbnail.startsWith("\xFF\xD8"));
+    EXPECT_EQ(file.thumbnail(), thumbnail);
+
+    Exif::Reader empty;
+    ASSERT_TRUE(empty.load(TmpJpegFile::withoutExif()));
+    EXPECT_TRUE(empty.uRationalVector(EXIF_IFD_GPS, Exif::Tag::GPS::LATITUDE).isEmpty());
+    EXPECT_TRUE(empty.ascii(EXIF_IFD_EXIF, EXIF_TAG_DATE_TIME_ORIGINAL).isEmpty());
+    EXPECT_TRUE(empty.thumbnail().isEmpty());
+}
@@ -0,0 +1,121 @@
+#include <gtest/gtest.h>
+
+#include "gpx/matcher.h"
+
+namespace
+{
+
+GPX::TrackStore track(const QVector<qint64>& times)
+{
+    GPX::TrackStore track;
+    for (qint64 time: times)
+        track.append(time, 50. + time / 1000., 10.);
+    return track;
+}
+
+} // namespace
+
+TEST(matcher, find)
+{
+    GPX::Matcher matcher;
+    matcher.setTrack(track({ 1000, 2000, 3000 }));
+
+    EXPECT_FALSE(matcher.find(999).isValid());
+    EXPECT_FALSE(matcher.find(3000).isValid());
+
+    GPX::Matcher::Match match = matcher.find(1500);
+    ASSERT_TRUE(match.isValid());
+    EXPECT_EQ(0, match.before);
+    EXPECT_EQ(1, match.after);
+    EXPECT_DOUBLE_EQ(51.5, matcher.position(match, 1500).latitude());
+
+    match = matcher.find(2000);
+    EXPECT_EQ(1, match.before);
+    EXPECT_EQ(2, match.after);
+}
+
+TEST(matcher, sweep_equals_binary_search)
+{
+    GPX::Matcher matcher;
+    matcher.setTrack(track({ 1000, 2000, 3000, 4000, 5000 }));
+
+    const QVector<qint64> ascending = { 500, 1000, 1001, 2500, 2500, 4999, 5000, 6000 };
+    const QVector<GPX::Matcher::Match> matches = matcher.find(ascending);
+    ASSERT_EQ(ascending.size(), matches.size());
+    for (int i = 0; i < ascending.size(); ++i)
+        EXPECT_TRUE(matcher.find(ascending[i]) == matches[i]) << ascending[i];
+
+    const QVector<qint64> shuffled = { 4999, 500, 2500, 1001 };
+    const QVector<GPX::Matcher::Match> unordered = matcher.find(shuffled);
+    for (int i = 0; i < shuffled.size(); ++i)
+        EXPECT_TRUE(matcher.find(shuffled[i]) == unordered[i]) << shuffled[i];
+}
+
+TEST(matcher, clock_jump)
+{
+    // the GPS clock went back, then the duplicate timestamp
+    GPX::Matcher matcher;
+    matcher.setTrack(track({ 1000, 3000, 2000, 4000, 4000 }));
+
+    GPX::Matcher::Match match = matcher.find(2500);
+    ASSERT_TRUE(match.isValid());
+    EXPECT_EQ(2, match.before);
+    EXPECT_EQ(1, match.after);
+
+    match = matcher.find(3500);
+    ASSERT_TRUE(match.isValid());
+    EXPECT_EQ(1, match.before);
+    EXPECT_EQ(3, match.after);
+
+    EXPECT_FALSE(matcher.find(4000).isValid());
+}
+
+TEST(matcher, merged_segments)
+{
+    // two loggers overlapping, then the next day's file
+    const qint64 day = 24 * 60 * 60 * 1000;
+    GPX::TrackStore merged = track({ 1000, 2000, 3000 });
+    merged.append(track({ 2500, 3500, 4500 }));
+    merged.append(track({ day, day + 1000 }));
+
+    GPX::Matcher matcher;
+    matcher.setTrack(merged);
+
+    // the earlier segment wins the overlap
+    GPX::Matcher::Match match = matcher.find(2700);
+    ASSERT_TRUE(match.isValid());
+    EXPECT_EQ(1, match.before);
+    EXPECT_EQ(2, match.after);
+
+    // a short break between the segments is interpolated over
+    match = matcher.find(3200);
+    ASSERT_TRUE(match.isValid());
+    EXPECT_EQ(2, match.before);
+    EXPECT_EQ(4, match.after);
+
+    // the night is not
+    EXPECT_FALSE(matcher.find(day / 2).isValid());
+    EXPECT_TRUE(matcher.find(day + 500).isValid());
+
+    matcher.setMaxGap(day);
+    EXPECT_TRUE(matcher.find(day / 2).isValid());
+}
+
+TEST(matcher, set_track_again)
+{
+    // the segment starts of the first track must not split the second one
+    const qint64 day = 24 * 60 * 60 * 1000;
+    GPX::TrackStore merged = track({ 1000, 2000 });
+    merged.append(track({ day, day + 1000 }));
+
+    GPX::Matcher matcher;
+    matcher.setTrack(merged);
+    EXPECT_FALSE(matcher.find(day / 2).isValid());
+
+    matcher.setTrack(track({ 1000, 2000, day }));
+    GPX::Matcher::Match match = matcher.find(day / 2);
+    ASSERT_TRUE(match.isValid());
+    EXPECT_EQ(1, match.before);
+    EXPECT_EQ(2, match.after);
+    EXPECT_FALSE(matcher.find(day + 500).isValid());
+}
@@ -0,0 +1,29 @@
+#include <gtest/gtest.h>
+
+#include "gpx/pyramid.h"
+
+TEST(pyramid, levels)
+{
+    // a straight line with a 1 km spike in the middle, then a segment of two points
+    GPX::TrackStore track;
+    for (int i = 0; i <= 100; ++i)
+        track.append(i * 1000, i == 50 ? 50.01 : 50., 10. + i * 0.001);
+    track.beginSegment();
+    track.append(200000, 50., 10.5);
+    track.append(201000, 50.01, 10.6);
+
+    const GPX::Pyramid pyramid = GPX::Pyramid::build(track);
+    ASSERT_FALSE(pyramid.isEmpty());
+
+    // the ends of the segments are always shown, the spike is a few pixels at zoom 6
+    EXPECT_EQ(QVector<int>({ 0, 100, 101, 102 }), pyramid.points(0));
+    EXPECT_EQ(QVector<int>({ 0, 100, 101, 102 }), pyramid.points(5));
+    EXPECT_EQ(QVector<int>({ 0, 49, 50, 51, 100, 101, 102 }), pyramid.points(6));
+
+    // the rest of the line is never shown
+    EXPECT_EQ(7, pyramid.size(GPX::Pyramid::MaxZoom));
+
+    EXPECT_EQ(4, pyramid.level(3.2, 1000));
+    EXPECT_EQ(5, pyramid.level(10, 4));
+    EXPECT_EQ(GPX::Pyramid::MaxZoom, pyramid.level(30, 1000));
+}
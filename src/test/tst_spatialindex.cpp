@@ -0,0 +1,36 @@
+#include <gtest/gtest.h>
+
+#include <QtMath>
+
+#include "spatialindex.h"
+
+TEST(spatialindex, cells)
+{
+    SpatialIndex index;
+    index.build({ { 0.9, 0.9 }, { 0.1, 0.1 }, { 0.1001, 0.1003 } }, { 10, 20, 30 });
+    ASSERT_EQ(3, index.size());
+
+    // quarters of the world: the close points share a cell
+    QVector<SpatialIndex::Cell> cells = index.cells(QRectF(0., 0., 1., 1.), 2);
+    ASSERT_EQ(2, cells.size());
+    EXPECT_EQ(2, cells[0].size());
+    EXPECT_DOUBLE_EQ(0.10005, cells[0].center.x());
+    EXPECT_DOUBLE_EQ(0.10015, cells[0].center.y());
+    EXPECT_EQ(1, cells[1].size());
+    EXPECT_EQ(10, index.id(cells[1].begin));
+
+    // the viewport culls the far one
+    cells = index.cells(QRectF(0., 0., 0.5, 0.5), 2);
+    ASSERT_EQ(1, cells.size());
+    EXPECT_EQ(2, cells[0].size());
+
+    // deep enough, every point is on its own
+    cells = index.cells(QRectF(0.09, 0.09, 0.02, 0.02), 16);
+    ASSERT_EQ(2, cells.size());
+    EXPECT_EQ(1, cells[0].size());
+    EXPECT_EQ(1, cells[1].size());
+
+    // a corner off the map has no position, all is in view then
+    cells = index.cells(QRectF(QPointF(qQNaN(), 0.2), QPointF(0.5, 0.5)), 2);
+    EXPECT_EQ(2, cells.size());
+}
@@ -0,0 +1,26 @@
+#include "thumbnailprovider.h"
+
+#include "model.h"
+
+ThumbnailProvider::ThumbnailProvider(const Model* model) :
+    QQuickImageProvider(QQuickImageProvider::Image),
+    mModel(model),
+    mNotAvailable(":/img/not_available.png")
+{
+}
+
+/// may be called from the QML image loading thread
+QImage ThumbnailProvider::requestImage(const QString& id, QSize* size, const QSize& requestedSize)
+{
+    QImage image = mModel->thumbnail(id);
+    if (image.isNull())
+        image = mNotAvailable;
+
+    if (requestedSize.isValid() && requestedSize != image.size())
+        image = image.scaled(requestedSize, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+
+    if (size)
+        *size = image.size();
+
+    return image;
+}
@@ -0,0 +1,23 @@
+#ifndef THUMBNAILPROVIDER_H
+#define THUMBNAILPROVIDER_H
+
+#include <QQuickImageProvider>
+
+class Model;
+
+/* Serves the photo thumbnails to QML as image://thumbs/<id> */
+
+class ThumbnailProvider : public QQuickImageProvider
+{
+public:
+    static constexpr const char* Name = "thumbs";
+
+    explicit ThumbnailProvider(const Model* model);
+    QImage requestImage(const QString& id, QSize* size, const QSize& requestedSize) override;
+
+private:
+    const Model* mModel;
+    QImage mNotAvailable;
+};
+
+#endif // THUMBNAILPROVIDER_H
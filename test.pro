@@ -7,6 +7,7 @@ CONFIG -= app_bundle
 GOOGLETEST_DIR = src/test/google
 include(google_dependency.pri)
 
+include(compression.pri)
 include(src/3rdparty/libexif/libexif.pri)
 include(src/3rdparty/libjpeg/libjpeg.pri)
 
@@ -16,19 +17,53 @@ INCLUDEPATH += \
 
 SOURCES += \
     src/exif/file.cpp \
+    src/exif/jpeg.cpp \
+    src/exif/reader.cpp \
     src/exif/utils.cpp \
+    src/gpx/decompressor.cpp \
+    src/gpx/fitreader.cpp \
+    src/gpx/geojsonreader.cpp \
+    src/gpx/gpxreader.cpp \
+    src/gpx/kmlreader.cpp \
     src/gpx/loader.cpp \
+    src/gpx/matcher.cpp \
+    src/gpx/nmeareader.cpp \
+    src/gpx/parser.cpp \
+    src/gpx/pyramid.cpp \
     src/gpx/statistic.cpp \
+    src/gpx/trackreader.cpp \
+    src/jpeg/journal.cpp \
+    src/spatialindex.cpp \
     src/test/tmpjpegfile.cpp \
+    src/test/tst_gpxparser.cpp \
+    src/test/tst_journal.cpp \
     src/test/tst_libexif.cpp \
-    src/test/tst_libexif_trivial.cpp
+    src/test/tst_libexif_trivial.cpp \
+    src/test/tst_matcher.cpp \
+    src/test/tst_pyramid.cpp \
+    src/test/tst_spatialindex.cpp
 
 HEADERS += \
     src/exif/file.h \
+    src/exif/jpeg.h \
+    src/exif/reader.h \
     src/exif/utils.h \
+    src/gpx/decompressor.h \
+    src/gpx/fitreader.h \
+    src/gpx/geojsonreader.h \
+    src/gpx/gpxreader.h \
+    src/gpx/kmlreader.h \
     src/gpx/loader.h \
+    src/gpx/matcher.h \
+    src/gpx/mercator.h \
+    src/gpx/nmeareader.h \
+    src/gpx/parser.h \
+    src/gpx/pyramid.h \
     src/gpx/statistic.h \
     src/gpx/track.h \
+    src/gpx/trackreader.h \
+    src/jpeg/journal.h \
+    src/spatialindex.h \
     src/test/tmpjpegfile.h
 
 RESOURCES += \